@@ -5,7 +5,27 @@
 
 
 #include "adc.h"
-#include "msp.h"
+#include "hal.h"
+
+
+// Sequence being converted (number of channels, MEM[0] to MEM[count-1])
+static int adcSequenceCount = 1;
+
+// Continuous mode: ring of the last conversions of each channel and their running sums
+static int adcRing[ADC_MAX_CHANNELS][ADC_RING_SIZE];
+static int adcRingIndex;
+static int adcRingSum[ADC_MAX_CHANNELS];
+static volatile int adcFiltered[ADC_MAX_CHANNELS];  // moving averages, read by adcLatest
+static volatile unsigned int adcUpdates;            // odd while the ISR is updating adcFiltered
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcBurst - stores a continuous mode burst and updates the moving averages.
+//                      Called from the ADC14 interrupt
+//  Arguments: results - digital result of every channel of the burst
+//  Return values: none
+/////////////////////////////////////////////////////////////////////////////////////////////
+static void adcBurst(const int *results);
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -15,14 +35,8 @@
 /////////////////////////////////////////////////////////////////////////////////////////////
 void adcInit(int analogChannel) {
 
-    //Clear ADC Enable Conv bit
-    ADC14->CTL0 &= ~ADC14_CTL0_ENC;
-
-    //Select analog input to sample to Mem[0]
-    ADC14->MCTL[0] = analogChannel;
-
-    //Set ADC Enable Conv bit (enable conversions)
-    ADC14->CTL0 |= ADC14_CTL0_ENC;
+    //A sequence of one channel
+    adcInitSequence(&analogChannel, 1);
 
 }
 
@@ -34,17 +48,164 @@ void adcInit(int analogChannel) {
 /////////////////////////////////////////////////////////////////////////////////////////////
 int adcSample() {
 
-    //Start the conversion
-    ADC14->CTL0 |= ADC14_CTL0_SC;
+    int results[ADC_MAX_CHANNELS];  // MEM[0] onwards
 
-    //Wait for conversion to complete
-    while (!(ADC14->IFGR0 & ADC14_IFGR0_IFG0)) {
-    }
+    //Convert and wait for the result
+    halAdcConvert(results);
 
     //Get the ADC result from the Mem[0] channel
-    return ADC14->MEM[0];
+    return results[0];
+
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcInitSequence - initializes ADC to convert a sequence of input channels in
+//                             one burst, channel n going into MEM[n]
+//  Arguments: analogChannels - the analog channels of the sequence
+//             count - number of channels (1 to ADC_MAX_CHANNELS)
+//  Return values: none
+/////////////////////////////////////////////////////////////////////////////////////////////
+void adcInitSequence(const int *analogChannels, int count) {
+
+    if (count > ADC_MAX_CHANNELS) {
+        count = ADC_MAX_CHANNELS;
+    } else if (count < 1) {
+        count = 1;
+    }
+    adcSequenceCount = count;
+
+    //Sequence of channels once per start by software, MEM[0] onwards
+    halAdcInit(analogChannels, count);
+
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcSampleSequence - converts the sequence set by adcInitSequence in one burst
+//  Arguments: results - filled with the digital result of every channel
+//  Return values: none
+/////////////////////////////////////////////////////////////////////////////////////////////
+void adcSampleSequence(adcResults *results) {
+
+    //Convert and wait for the last channel of the sequence
+    halAdcConvert(results->value);
+    results->count = adcSequenceCount;
+
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcStartContinuous - samples the selected input channel continuously in the
+//                                background.  Timer_A1 triggers one conversion every
+//                                1/ADC_SAMPLE_HZ, and the ADC14 interrupt keeps a moving
+//                                average of the last ADC_RING_SIZE results and re-arms
+//                                the ADC for the next trigger
+//  Arguments: analogChannel - the analog channel to be put into MEM[0]
+//  Return values: none
+/////////////////////////////////////////////////////////////////////////////////////////////
+void adcStartContinuous(int analogChannel) {
+
+    adcStartContinuousSequence(&analogChannel, 1);
 
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcStartContinuousSequence - same as adcStartContinuous, but every trigger
+//                                        converts a whole sequence of channels in one burst
+//                                        and each channel gets its own moving average
+//  Arguments: analogChannels - the analog channels of the sequence
+//             count - number of channels (1 to ADC_MAX_CHANNELS)
+//  Return values: none
+/////////////////////////////////////////////////////////////////////////////////////////////
+void adcStartContinuousSequence(const int *analogChannels, int count) {
+
+    adcResults first;   // first burst, used to fill the rings
+    int channel;        // index into the sequence
+    int index;          // index into the ring
+
+    //Take one burst by software first so the averages start out settled
+    adcInitSequence(analogChannels, count);
+    adcSampleSequence(&first);
+
+    for (channel = 0; channel < first.count; channel++) {
+        adcRingSum[channel] = 0;
+        for (index = 0; index < ADC_RING_SIZE; index++) {
+            adcRing[channel][index] = first.value[channel];
+            adcRingSum[channel] += first.value[channel];
+        }
+        adcFiltered[channel] = first.value[channel];
+    }
+    adcRingIndex = 0;
+
+    //Convert the sequence once per Timer_A1 trigger, re-armed by the ADC14 interrupt
+    halAdcStartTimer(HAL_SMCLK_HZ / ADC_SAMPLE_HZ, adcBurst);
+
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcLatest - gets the latest filtered result of continuous mode, never blocks
+//  Arguments: none
+//  Return values: int of filtered digital result of the first channel
+/////////////////////////////////////////////////////////////////////////////////////////////
+int adcLatest() {
+
+    //Single word read, so no need to stop the ADC interrupt
+    return adcFiltered[0];
+
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcLatestSequence - gets the latest filtered results of every channel of
+//                               continuous mode, all from the same burst. Never blocks
+//  Arguments: results - filled with the filtered result of every channel
+//  Return values: none
+/////////////////////////////////////////////////////////////////////////////////////////////
+void adcLatestSequence(adcResults *results) {
+
+    unsigned int updates;   // value of adcUpdates before copying
+    int channel;            // index into the sequence
+
+    //Copy again if the ISR updated the results part way through
+    do {
+        updates = adcUpdates;
+        results->count = adcSequenceCount;
+        for (channel = 0; channel < adcSequenceCount; channel++) {
+            results->value[channel] = adcFiltered[channel];
+        }
+    } while ((updates & 1) || updates != adcUpdates);
+
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcBurst - stores a continuous mode burst and updates the moving averages.
+//                      Called from the ADC14 interrupt
+//  Arguments: results - digital result of every channel of the burst
+//  Return values: none
+/////////////////////////////////////////////////////////////////////////////////////////////
+static void adcBurst(const int *results) {
 
+    int channel;    // index into the sequence
+    int sample;     // result of the channel
+
+    adcUpdates++;
+
+    for (channel = 0; channel < adcSequenceCount; channel++) {
+
+        sample = results[channel];
+
+        //Replace oldest sample of the ring and keep the running sum
+        adcRingSum[channel] += sample - adcRing[channel][adcRingIndex];
+        adcRing[channel][adcRingIndex] = sample;
+
+        adcFiltered[channel] = adcRingSum[channel] >> ADC_AVERAGE_SHIFT;
+    }
+    adcRingIndex = (adcRingIndex + 1) & (ADC_RING_SIZE - 1);
+
+    adcUpdates++;
+
+}
@@ -3,6 +3,21 @@
 //  Set: T
 //  Date: October 21, 2020
 
+#ifndef ADC_H_
+#define ADC_H_
+
+#define ADC_SAMPLE_HZ       2000        //  Conversions per second in continuous mode
+#define ADC_AVERAGE_SHIFT   3           //  Continuous mode averages the last 2^shift conversions
+#define ADC_RING_SIZE       (1 << ADC_AVERAGE_SHIFT)
+
+#define ADC_MAX_CHANNELS    8           //  Most channels in one conversion sequence (MEM[0] to MEM[7])
+
+//  Results of one conversion sequence, in the order the channels were given
+typedef struct {
+    int count;                          //  Number of channels in the sequence
+    int value[ADC_MAX_CHANNELS];        //  Digital result of each channel (MEM[0] onwards)
+} adcResults;
+
 
 /////////////////////////////////////////////////////////////////////////////////////////////
 //  Function adcInit - initializes ADC for single conversions on the selected input channel
@@ -18,3 +33,63 @@ void adcInit(int analog_channel);
 //  Return values: int of digital result MEM[0]
 /////////////////////////////////////////////////////////////////////////////////////////////
 int adcSample();
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcInitSequence - initializes ADC to convert a sequence of input channels in
+//                             one burst, channel n going into MEM[n]
+//  Arguments: analogChannels - the analog channels of the sequence
+//             count - number of channels (1 to ADC_MAX_CHANNELS)
+//  Return values: none
+/////////////////////////////////////////////////////////////////////////////////////////////
+void adcInitSequence(const int *analogChannels, int count);
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcSampleSequence - converts the sequence set by adcInitSequence in one burst
+//  Arguments: results - filled with the digital result of every channel
+//  Return values: none
+/////////////////////////////////////////////////////////////////////////////////////////////
+void adcSampleSequence(adcResults *results);
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcStartContinuous - samples the selected input channel continuously in the
+//                                background.  Timer_A1 triggers one conversion every
+//                                1/ADC_SAMPLE_HZ, and the ADC14 interrupt keeps a moving
+//                                average of the last ADC_RING_SIZE results and re-arms
+//                                the ADC for the next trigger
+//  Arguments: analogChannel - the analog channel to be put into MEM[0]
+//  Return values: none
+/////////////////////////////////////////////////////////////////////////////////////////////
+void adcStartContinuous(int analogChannel);
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcStartContinuousSequence - same as adcStartContinuous, but every trigger
+//                                        converts a whole sequence of channels in one burst
+//                                        and each channel gets its own moving average
+//  Arguments: analogChannels - the analog channels of the sequence
+//             count - number of channels (1 to ADC_MAX_CHANNELS)
+//  Return values: none
+/////////////////////////////////////////////////////////////////////////////////////////////
+void adcStartContinuousSequence(const int *analogChannels, int count);
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcLatest - gets the latest filtered result of continuous mode, never blocks
+//  Arguments: none
+//  Return values: int of filtered digital result of the first channel
+/////////////////////////////////////////////////////////////////////////////////////////////
+int adcLatest();
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+//  Function adcLatestSequence - gets the latest filtered results of every channel of
+//                               continuous mode, all from the same burst. Never blocks
+//  Arguments: results - filled with the filtered result of every channel
+//  Return values: none
+/////////////////////////////////////////////////////////////////////////////////////////////
+void adcLatestSequence(adcResults *results);
+
+#endif /* ADC_H_ */
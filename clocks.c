@@ -0,0 +1,114 @@
+// Filename: clocks.c
+// Description: Clock configurations of the MSP432 and the bus rates they give, see clocks.h
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#include "clocks.h"
+
+#define DCO_RANGE_0_HZ      1500000UL   // centre of DCORSEL 0, each range doubles it
+#define FLASH_0WAIT_VCORE0  12000000    // fastest MCLK without flash wait states, per core voltage
+#define FLASH_0WAIT_VCORE1  16000000
+
+const clockConfig clockConfigs[CLOCK_CONFIGS] = {
+    // name      DCO        range  vcore  waits  divs  spi  i2c  tick /8 /2
+    { "3MHz",    3000000,   1,     0,     0,     0,    1,   8,   3,  1 },
+    // tick /8 /8 and i2c /32 keep their 3MHz rates
+    { "48MHz",   48000000,  5,     1,     1,     2,    1,   32,  3,  7 },
+};
+
+///////////////////////////////////////////////////////////////////////
+// clockSmclkHz - Gets the SMCLK frequency of a configuration
+// Arguments: config - clock configuration
+// Return Value: frequency in Hz
+///////////////////////////////////////////////////////////////////////
+unsigned long clockSmclkHz(const clockConfig *config)
+{
+    return config->dcoHz >> config->smclkDivs;
+}
+
+///////////////////////////////////////////////////////////////////////
+// clockSpiHz - Gets the LCD SPI clock of a configuration
+// Arguments: config - clock configuration
+// Return Value: frequency in Hz
+///////////////////////////////////////////////////////////////////////
+unsigned long clockSpiHz(const clockConfig *config)
+{
+    // a divider of 0 divides by 1, like 1
+    return clockSmclkHz(config) / (config->spiDivider ? config->spiDivider : 1);
+}
+
+///////////////////////////////////////////////////////////////////////
+// clockI2cHz - Gets the i2c clock of a configuration
+// Arguments: config - clock configuration
+// Return Value: frequency in Hz
+///////////////////////////////////////////////////////////////////////
+unsigned long clockI2cHz(const clockConfig *config)
+{
+    return clockSmclkHz(config) / (config->i2cDivider ? config->i2cDivider : 1);
+}
+
+///////////////////////////////////////////////////////////////////////
+// clockTickHz - Gets the count rate of the Timer_A0 tick
+// Arguments: config - clock configuration
+// Return Value: frequency in Hz
+///////////////////////////////////////////////////////////////////////
+unsigned long clockTickHz(const clockConfig *config)
+{
+    return (clockSmclkHz(config) >> config->tickId) / (config->tickIdex + 1);
+}
+
+///////////////////////////////////////////////////////////////////////
+// clockSpiNs - Gets the time the SPI takes to shift out some bytes
+// Arguments: config - clock configuration
+//            bytes - number of bytes sent back to back
+// Return Value: time in ns
+///////////////////////////////////////////////////////////////////////
+unsigned long long clockSpiNs(const clockConfig *config, unsigned long bytes)
+{
+    return bytes * 8ULL * 1000000000ULL / clockSpiHz(config);
+}
+
+///////////////////////////////////////////////////////////////////////
+// clockCheck - Checks a configuration against the datasheet limits
+//              and the rates the rest of the code expects
+// Arguments: config - clock configuration
+// Return Value: 0 if it is good, else what is wrong with it
+///////////////////////////////////////////////////////////////////////
+const char *clockCheck(const clockConfig *config)
+{
+    unsigned long noWaitMax = config->vcore ? FLASH_0WAIT_VCORE1 : FLASH_0WAIT_VCORE0;
+
+    if(config->dcoRange < 0 || config->dcoRange > 5 || config->dcoHz != (DCO_RANGE_0_HZ << config->dcoRange)) {
+        return "DCO frequency is not the centre of its DCORSEL range";
+    }
+    if(config->dcoHz > CLOCK_MCLK_MAX) {
+        return "MCLK above 48MHz";
+    }
+    if(config->dcoHz > CLOCK_VCORE0_MAX && config->vcore < 1) {
+        return "MCLK above 24MHz needs VCORE1";
+    }
+    if(config->dcoHz > noWaitMax && config->flashWaits < 1) {
+        return "MCLK too fast for flash without wait states";
+    }
+    if(clockSmclkHz(config) > CLOCK_SMCLK_MAX) {
+        return "SMCLK above 24MHz";
+    }
+    if(clockSpiHz(config) > CLOCK_SPI_MAX) {
+        return "SPI clock faster than the ST7735 takes";
+    }
+    if(clockI2cHz(config) > CLOCK_I2C_MAX) {
+        return "i2c clock above 400kHz";
+    }
+    if(config->tickId < 0 || config->tickId > 3 || config->tickIdex < 0 || config->tickIdex > 7) {
+        return "Timer_A0 divider out of range";
+    }
+    if(clockTickHz(config) != CLOCK_TICK_HZ) {
+        return "Timer_A0 does not count at CLOCK_TICK_HZ";
+    }
+    if(config == &clockConfigs[CLOCK_CONFIG]
+       && (config->dcoHz != CLOCK_MCLK_HZ || clockSmclkHz(config) != CLOCK_SMCLK_HZ)) {
+        return "CLOCK_MCLK_HZ/CLOCK_SMCLK_HZ do not match the configuration";
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Filename: clocks.h
+// Description: Clock configurations of the MSP432. Each entry of clockConfigs holds the
+//              register settings of one configuration, and the functions below work out the
+//              bus rates they give, so a configuration can be checked (and its SPI timing
+//              estimated) off the board. The one used is picked at compile time with
+//              CLOCK_CONFIG (CLOCK_48MHZ unless the project defines it).
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#ifndef CLOCKS_H_
+#define CLOCKS_H_
+
+// Configurations, index into clockConfigs
+#define CLOCK_3MHZ          0       // DCO left at its 3MHz reset frequency, SPI at 3MHz
+#define CLOCK_48MHZ         1       // 48MHz CPU, 12MHz SMCLK and SPI
+#define CLOCK_CONFIGS       2
+
+#ifndef CLOCK_CONFIG
+#define CLOCK_CONFIG        CLOCK_48MHZ
+#endif
+
+// Frequencies of the configuration picked, for the delays and the simulator. These
+// must match its clockConfigs entry, clockCheck makes sure they do.
+#if CLOCK_CONFIG == CLOCK_48MHZ
+#define CLOCK_MCLK_HZ       48000000
+#define CLOCK_SMCLK_HZ      12000000
+#else
+#define CLOCK_MCLK_HZ       3000000
+#define CLOCK_SMCLK_HZ      3000000
+#endif
+
+#define CLOCK_TICK_HZ       187500  // Timer_A0 count rate, the same in every configuration
+
+// Limits the configurations are checked against (MSP432P401R and ST7735 datasheets)
+#define CLOCK_MCLK_MAX      48000000    // CPU, needs VCORE1 above CLOCK_VCORE0_MAX
+#define CLOCK_VCORE0_MAX    24000000
+#define CLOCK_SMCLK_MAX     24000000
+#define CLOCK_SPI_MAX       15000000    // ST7735 serial write cycle is 66ns at the least
+#define CLOCK_I2C_MAX       400000
+
+// Register settings of one configuration
+typedef struct {
+    const char *name;
+    unsigned long dcoHz;    // DCO frequency, MCLK runs straight from it
+    int dcoRange;           // CS DCORSEL, the range dcoHz is the centre of
+    int vcore;              // PCM core voltage, 0 or 1 (AM_LDO_VCORE1)
+    int flashWaits;         // FLCTL wait states of both flash banks
+    int smclkDivs;          // CS DIVS, SMCLK = DCO / 2^smclkDivs
+    int spiDivider;         // UCB0BRW, SPI clock = SMCLK / spiDivider
+    int i2cDivider;         // UCB1BRW, i2c clock = SMCLK / i2cDivider
+    int tickId;             // Timer_A0 ID, SMCLK / 2^tickId ...
+    int tickIdex;           // ... / (tickIdex + 1) (TAxEX0)
+} clockConfig;
+
+extern const clockConfig clockConfigs[CLOCK_CONFIGS];
+
+///////////////////////////////////////////////////////////////////////
+// clockSmclkHz - Gets the SMCLK frequency of a configuration
+// Arguments: config - clock configuration
+// Return Value: frequency in Hz
+///////////////////////////////////////////////////////////////////////
+unsigned long clockSmclkHz(const clockConfig *config);
+
+///////////////////////////////////////////////////////////////////////
+// clockSpiHz - Gets the LCD SPI clock of a configuration
+// Arguments: config - clock configuration
+// Return Value: frequency in Hz
+///////////////////////////////////////////////////////////////////////
+unsigned long clockSpiHz(const clockConfig *config);
+
+///////////////////////////////////////////////////////////////////////
+// clockI2cHz - Gets the i2c clock of a configuration
+// Arguments: config - clock configuration
+// Return Value: frequency in Hz
+///////////////////////////////////////////////////////////////////////
+unsigned long clockI2cHz(const clockConfig *config);
+
+///////////////////////////////////////////////////////////////////////
+// clockTickHz - Gets the count rate of the Timer_A0 tick
+// Arguments: config - clock configuration
+// Return Value: frequency in Hz
+///////////////////////////////////////////////////////////////////////
+unsigned long clockTickHz(const clockConfig *config);
+
+///////////////////////////////////////////////////////////////////////
+// clockSpiNs - Gets the time the SPI takes to shift out some bytes
+// Arguments: config - clock configuration
+//            bytes - number of bytes sent back to back
+// Return Value: time in ns
+///////////////////////////////////////////////////////////////////////
+unsigned long long clockSpiNs(const clockConfig *config, unsigned long bytes);
+
+///////////////////////////////////////////////////////////////////////
+// clockCheck - Checks a configuration against the datasheet limits
+//              and the rates the rest of the code expects
+// Arguments: config - clock configuration
+// Return Value: 0 if it is good, else what is wrong with it
+///////////////////////////////////////////////////////////////////////
+const char *clockCheck(const clockConfig *config);
+
+#endif /* CLOCKS_H_ */
@@ -0,0 +1,172 @@
+// Filename: collide.c
+// Description: Swept circle against rectangle collision, see collide.h
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#include "collide.h"
+
+// Squares of Q8.8 positions take more than 32 bits, the sums below are worked in 64
+
+///////////////////////////////////////////////////////////////////////
+// collideSqrt - Integer square root
+// Arguments: value - number to take the root of
+// Return Value: largest root whose square is not above value
+///////////////////////////////////////////////////////////////////////
+static unsigned long long collideSqrt(unsigned long long value)
+{
+    unsigned long long root = 0;
+    unsigned long long bit = 1ULL << 62;
+
+    while(bit > value) {
+        bit >>= 2;
+    }
+    while(bit) {
+        if(value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+///////////////////////////////////////////////////////////////////////
+// collideTime - Turns a fraction of the move into Q8.8
+// Arguments: part, whole - fraction, 0 <= part <= whole, whole > 0
+// Return Value: the fraction, 0 to FIX_ONE
+///////////////////////////////////////////////////////////////////////
+static int collideTime(long long part, long long whole)
+{
+    return (int)(part * FIX_ONE / whole);
+}
+
+///////////////////////////////////////////////////////////////////////
+// collideSide - Finds when the centre crosses one straight side of the
+//               rounded rectangle, coming from outside
+// Arguments: start, move - centre at the start and its move, along the
+//                          axis the side is across
+//            side - where the side is on that axis
+//            across, acrossMove - centre at the start and its move, along
+//                                 the side
+//            low, high - ends of the side
+// Return Value: time of the crossing, 0 to FIX_ONE, or COLLIDE_NONE
+///////////////////////////////////////////////////////////////////////
+static int collideSide(long long start, long long move, long long side, long long across, long long acrossMove,
+                       long long low, long long high)
+{
+    long long part = side - start;
+    long long along;
+
+    // must move towards the side, and reach it
+    if(move == 0 || part == 0 || (part < 0) != (move < 0)) {
+        return COLLIDE_NONE;
+    }
+    if(move < 0) {
+        part = -part;
+        move = -move;
+    }
+    if(part > move) {
+        return COLLIDE_NONE;
+    }
+
+    // where along the side it is crossed, times move so nothing is rounded
+    along = across * move + acrossMove * part;
+    if(along < low * move || along > high * move) {
+        return COLLIDE_NONE;
+    }
+    return collideTime(part, move);
+}
+
+///////////////////////////////////////////////////////////////////////
+// collideCorner - Finds when the centre enters the circle around one
+//                 corner of the rectangle, coming from outside
+// Arguments: x0, y0 - centre at the start
+//            dx, dy - move of the centre
+//            cornerX, cornerY - corner of the rectangle
+//            radius - radius of the moving circle
+// Return Value: time of the contact, 0 to FIX_ONE, or COLLIDE_NONE
+///////////////////////////////////////////////////////////////////////
+static int collideCorner(long long x0, long long y0, long long dx, long long dy,
+                         long long cornerX, long long cornerY, long long radius)
+{
+    long long offsetX = x0 - cornerX;
+    long long offsetY = y0 - cornerY;
+    long long a, b, c, discriminant, part;
+
+    // |offset + t*move| = radius, a t^2 + 2 b t + c = 0
+    a = dx * dx + dy * dy;
+    b = offsetX * dx + offsetY * dy;
+    c = offsetX * offsetX + offsetY * offsetY - radius * radius;
+
+    // not moving, or moving away from the corner
+    if(a == 0 || b >= 0) {
+        return COLLIDE_NONE;
+    }
+    discriminant = b * b - a * c;
+    if(discriminant < 0) {
+        return COLLIDE_NONE;
+    }
+
+    // first of the two roots, the one going in
+    part = -b - (long long)collideSqrt((unsigned long long)discriminant);
+    if(part < 0 || part > a) {
+        return COLLIDE_NONE;
+    }
+    return collideTime(part, a);
+}
+
+///////////////////////////////////////////////////////////////////////
+// collideCircleRect - Finds when a circle moving in a straight line
+//                     first touches a rectangle. A circle already
+//                     touching it at the start of the move is not a
+//                     contact, it must come in from outside.
+// Arguments: x0, y0 - centre of the circle at the start of the move
+//            x1, y1 - centre of the circle at the end of the move
+//            radius - radius of the circle
+//            left, bottom, right, top - edges of the rectangle, inclusive
+//            (all Q8.8)
+// Return Value: time of the contact as a fraction of the move, 0 to
+//               FIX_ONE, or COLLIDE_NONE
+///////////////////////////////////////////////////////////////////////
+int collideCircleRect(int x0, int y0, int x1, int y1, int radius, int left, int bottom, int right, int top)
+{
+    long long dx = (long long)x1 - x0;
+    long long dy = (long long)y1 - y0;
+    long long nearX, nearY;
+    int times[8];
+    int first = COLLIDE_NONE;
+    int index;
+
+    // Whole move clear of the rectangle grown by the radius, the usual case
+    if((x0 > x1 ? x0 : x1) < left - radius || (x0 < x1 ? x0 : x1) > right + radius
+       || (y0 > y1 ? y0 : y1) < bottom - radius || (y0 < y1 ? y0 : y1) > top + radius) {
+        return COLLIDE_NONE;
+    }
+
+    // Already touching: the nearest point of the rectangle is within the radius
+    nearX = x0 < left ? left : (x0 > right ? right : x0);
+    nearY = y0 < bottom ? bottom : (y0 > top ? top : y0);
+    if((x0 - nearX) * (x0 - nearX) + (y0 - nearY) * (y0 - nearY) <= (long long)radius * radius) {
+        return COLLIDE_NONE;
+    }
+
+    // Every way in, the first one taken is the contact
+    times[0] = collideSide(y0, dy, (long long)top + radius, x0, dx, left, right);
+    times[1] = collideSide(y0, dy, (long long)bottom - radius, x0, dx, left, right);
+    times[2] = collideSide(x0, dx, (long long)left - radius, y0, dy, bottom, top);
+    times[3] = collideSide(x0, dx, (long long)right + radius, y0, dy, bottom, top);
+    times[4] = collideCorner(x0, y0, dx, dy, left, top, radius);
+    times[5] = collideCorner(x0, y0, dx, dy, right, top, radius);
+    times[6] = collideCorner(x0, y0, dx, dy, left, bottom, radius);
+    times[7] = collideCorner(x0, y0, dx, dy, right, bottom, radius);
+
+    for(index = 0; index < 8; index++) {
+        if(times[index] != COLLIDE_NONE && (first == COLLIDE_NONE || times[index] < first)) {
+            first = times[index];
+        }
+    }
+    return first;
+}
@@ -0,0 +1,39 @@
+// Filename: collide.h
+// Description: Swept collision of a moving circle against a rectangle, in integer fixed point.
+//              The move of one tick is tested as a whole, so a ball can move any distance per
+//              tick without passing through the pedal between two positions.
+//
+//              Positions are Q8.8 (FIX_ONE is one pixel). The rectangle with the circle's radius
+//              around it is a rectangle with rounded corners, and the centre of the circle
+//              touches the rectangle when it enters that shape: through one of its 4 straight
+//              sides, or one of the 4 circles of the corners.
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#ifndef COLLIDE_H_
+#define COLLIDE_H_
+
+#define FIX_SHIFT           8                   // fraction bits of a position
+#define FIX_ONE             (1 << FIX_SHIFT)    // one pixel
+#define FIX(pixels)         ((pixels) * FIX_ONE)
+#define FIX_PIXEL(fixed)    (((fixed) + FIX_ONE / 2) >> FIX_SHIFT)  // nearest pixel
+
+#define COLLIDE_NONE        -1                  // no contact during the move
+
+///////////////////////////////////////////////////////////////////////
+// collideCircleRect - Finds when a circle moving in a straight line
+//                     first touches a rectangle. A circle already
+//                     touching it at the start of the move is not a
+//                     contact, it must come in from outside.
+// Arguments: x0, y0 - centre of the circle at the start of the move
+//            x1, y1 - centre of the circle at the end of the move
+//            radius - radius of the circle
+//            left, bottom, right, top - edges of the rectangle, inclusive
+//            (all Q8.8)
+// Return Value: time of the contact as a fraction of the move, 0 to
+//               FIX_ONE, or COLLIDE_NONE
+///////////////////////////////////////////////////////////////////////
+int collideCircleRect(int x0, int y0, int x1, int y1, int radius, int left, int bottom, int right, int top);
+
+#endif /* COLLIDE_H_ */
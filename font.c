@@ -0,0 +1,211 @@
+// Filename: font.c
+// Description: 5x7 text for the LCD, see font.h
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#include "lcd.h"
+#include "font.h"
+
+#define FONT_FIRST          '0'     // first character of the atlas
+#define FONT_LAST           'Z'     // last character of the atlas
+#define FONT_BLANK          -1      // glyph index of a space
+
+// Glyph atlas, one byte per row from the top, the left column in bit 4
+static const unsigned char fontAtlas[FONT_LAST - FONT_FIRST + 1][FONT_HEIGHT] = {
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },   // 0
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },   // 1
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },   // 2
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },   // 3
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },   // 4
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },   // 5
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },   // 6
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },   // 7
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },   // 8
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },   // 9
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 },   // :
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // ; (blank)
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // < (blank)
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // = (blank)
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // > (blank)
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // ? (blank)
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // @ (blank)
+    { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },   // A
+    { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },   // B
+    { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E },   // C
+    { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C },   // D
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F },   // E
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },   // F
+    { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F },   // G
+    { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },   // H
+    { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },   // I
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },   // J
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },   // K
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },   // L
+    { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 },   // M
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },   // N
+    { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },   // O
+    { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },   // P
+    { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D },   // Q
+    { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },   // R
+    { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E },   // S
+    { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },   // T
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },   // U
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },   // V
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A },   // W
+    { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },   // X
+    { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 },   // Y
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F },   // Z
+};
+
+///////////////////////////////////////////////////////////////////////
+// fontGlyph - Gets the atlas entry a character is drawn with
+// Arguments: c - character
+// Return Value: index into fontAtlas, FONT_BLANK for a space
+///////////////////////////////////////////////////////////////////////
+static int fontGlyph(char c)
+{
+    if(c >= 'a' && c <= 'z') {
+        c = c - 'a' + 'A';
+    }
+    if(c < FONT_FIRST || c > FONT_LAST) {
+        return FONT_BLANK;
+    }
+    return c - FONT_FIRST;
+}
+
+///////////////////////////////////////////////////////////////////////
+// fontDrawGlyph - Draws one glyph with its background, as one window
+// Arguments: x, y - bottom left corner of the glyph
+//            c - character to draw
+//            colour - A 16 bit RGB colour for the glyph
+//            background - A 16 bit RGB colour around it
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void fontDrawGlyph(int x, int y, char c, int colour, int background)
+{
+    int glyph = fontGlyph(c);
+    int row, column;
+    int runColour = background;     // run of equal colour pixels being streamed
+    int runLength = 0;
+    int pixel;
+
+    lcdSetWindow(x, y, x + FONT_WIDTH - 1, y + FONT_HEIGHT - 1);
+
+    if(glyph == FONT_BLANK) {
+        lcdPushPixels(background, FONT_WIDTH * FONT_HEIGHT);
+        return;
+    }
+
+    // window is streamed from the bottom row up, each row from its right end
+    for(row = FONT_HEIGHT - 1; row >= 0; row--) {
+        for(column = 0; column < FONT_WIDTH; column++) {
+            pixel = (fontAtlas[glyph][row] & (1 << column)) ? colour : background;
+            if(pixel != runColour && runLength) {
+                lcdPushPixels(runColour, runLength);
+                runLength = 0;
+            }
+            runColour = pixel;
+            runLength++;
+        }
+    }
+    lcdPushPixels(runColour, runLength);
+}
+
+///////////////////////////////////////////////////////////////////////
+// fontTextInit - Lays out text at a place on the screen, with nothing
+//                drawn yet
+// Arguments: text - text to lay out
+//            x, y - bottom left corner of the first cell
+//            colour - A 16 bit RGB colour for the glyphs
+//            background - A 16 bit RGB colour around them, the cells
+//                         must already be this colour
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void fontTextInit(fontText *text, int x, int y, int colour, int background)
+{
+    text->x = x;
+    text->y = y;
+    text->colour = colour;
+    text->background = background;
+    fontTextForget(text);
+}
+
+///////////////////////////////////////////////////////////////////////
+// fontTextDraw - Changes the text on the screen, only drawing the
+//                cells whose glyph changed.  Cells past the end of the
+//                new text are blanked if they held a glyph.
+// Arguments: text - text laid out by fontTextInit
+//            string - new text, cut at FONT_TEXT_MAX characters
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void fontTextDraw(fontText *text, const char *string)
+{
+    int cell;
+    int ended = 0;      // past the end of the new text
+    int drawnEnded = 0; // past the end of the text on screen
+    char c, old;
+
+    for(cell = 0; cell < FONT_TEXT_MAX; cell++) {
+
+        if(!ended && !string[cell]) {
+            ended = 1;
+        }
+        if(!drawnEnded && !text->drawn[cell]) {
+            drawnEnded = 1;
+        }
+        if(ended && drawnEnded) {
+            break;
+        }
+
+        c = ended ? ' ' : string[cell];
+        old = drawnEnded ? ' ' : text->drawn[cell];
+
+        // same glyph (spaces and characters without one are all blank) is left alone
+        if(fontGlyph(c) != fontGlyph(old)) {
+            fontDrawGlyph(text->x + cell * FONT_ADVANCE, text->y, c, text->colour, text->background);
+        }
+        text->drawn[cell] = ended ? 0 : c;
+    }
+    text->drawn[FONT_TEXT_MAX] = 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// fontTextForget - Forgets what is drawn, for when the cells were
+//                  painted over with the background (after a clear)
+// Arguments: text - text laid out by fontTextInit
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void fontTextForget(fontText *text)
+{
+    text->drawn[0] = 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// fontNumber - Writes a number in decimal
+// Arguments: buffer - where to write it, 12 characters are enough for
+//                     any int, and a terminating 0 is added
+//            value - number to write
+// Return Value: number of characters written, without the 0
+///////////////////////////////////////////////////////////////////////
+int fontNumber(char *buffer, int value)
+{
+    char digits[10];    // digits from the lowest up
+    unsigned int magnitude = (value < 0) ? 0u - (unsigned int)value : (unsigned int)value;
+    int count = 0;
+    int length = 0;
+
+    do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while(magnitude);
+
+    if(value < 0) {
+        buffer[length++] = '-';
+    }
+    while(count) {
+        buffer[length++] = digits[--count];
+    }
+    buffer[length] = 0;
+    return length;
+}
@@ -0,0 +1,76 @@
+// Filename: font.h
+// Description: 5x7 text for the LCD, from a 1 bit per pixel glyph atlas kept in flash.
+//              A fontText remembers the glyph drawn in each of its cells, so drawing new
+//              text only sends the glyphs that changed (a digit is about 90 SPI bytes, see make bench).
+//              Digits, capital letters and ':' are drawn, lower case is drawn as capitals
+//              and anything else as a space.
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#ifndef FONT_H_
+#define FONT_H_
+
+#define FONT_WIDTH          5       // pixels across a glyph
+#define FONT_HEIGHT         7       // pixels up a glyph
+#define FONT_ADVANCE        6       // pixels from one cell to the next, a blank column between glyphs
+#define FONT_TEXT_MAX       20      // most cells of a fontText (the width of the screen)
+
+// Text at a fixed place on the screen and what of it is drawn
+typedef struct {
+    int x, y;                       // bottom left corner of the first cell
+    int colour;                     // colour of the glyphs
+    int background;                 // colour around them
+    char drawn[FONT_TEXT_MAX + 1];  // text on screen, cells past its end are background
+} fontText;
+
+///////////////////////////////////////////////////////////////////////
+// fontDrawGlyph - Draws one glyph with its background, as one window
+// Arguments: x, y - bottom left corner of the glyph
+//            c - character to draw
+//            colour - A 16 bit RGB colour for the glyph
+//            background - A 16 bit RGB colour around it
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void fontDrawGlyph(int x, int y, char c, int colour, int background);
+
+///////////////////////////////////////////////////////////////////////
+// fontTextInit - Lays out text at a place on the screen, with nothing
+//                drawn yet
+// Arguments: text - text to lay out
+//            x, y - bottom left corner of the first cell
+//            colour - A 16 bit RGB colour for the glyphs
+//            background - A 16 bit RGB colour around them, the cells
+//                         must already be this colour
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void fontTextInit(fontText *text, int x, int y, int colour, int background);
+
+///////////////////////////////////////////////////////////////////////
+// fontTextDraw - Changes the text on the screen, only drawing the
+//                cells whose glyph changed.  Cells past the end of the
+//                new text are blanked if they held a glyph.
+// Arguments: text - text laid out by fontTextInit
+//            string - new text, cut at FONT_TEXT_MAX characters
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void fontTextDraw(fontText *text, const char *string);
+
+///////////////////////////////////////////////////////////////////////
+// fontTextForget - Forgets what is drawn, for when the cells were
+//                  painted over with the background (after a clear)
+// Arguments: text - text laid out by fontTextInit
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void fontTextForget(fontText *text);
+
+///////////////////////////////////////////////////////////////////////
+// fontNumber - Writes a number in decimal
+// Arguments: buffer - where to write it, 12 characters are enough for
+//                     any int, and a terminating 0 is added
+//            value - number to write
+// Return Value: number of characters written, without the 0
+///////////////////////////////////////////////////////////////////////
+int fontNumber(char *buffer, int value);
+
+#endif /* FONT_H_ */
@@ -0,0 +1,332 @@
+//  game.c - Game state, with the update and render steps of the main loop
+//  Author: Jimmy Bates
+//  Set: T
+//  Date: December 2, 2020
+
+#include "lcd.h"
+#include "gamefunctions.h"
+#include "game.h"
+#include "collide.h"
+#include <string.h>
+
+// Balls in play at each level
+static const int levelBalls[END_LEVEL+1] = { 1, 1, 2, 2, 3 };
+
+// Speed the balls fall and rise at each level, Q8.8 pixels per tick (1.5 up to 3.75)
+static const int levelSpeed[END_LEVEL+1] = { 384, 480, 608, 768, 960 };
+
+
+/////////////////////////////////////////////////////
+//  levelSpeedOf - Speed of the balls at a level, the last level's once the game is won
+//  Arguments: level - level of the game, may be past END_LEVEL
+//  Return value: speed, Q8.8 pixels per tick
+/////////////////////////////////////////////////////
+static int levelSpeedOf(int level) {
+
+    return levelSpeed[(level>END_LEVEL) ? END_LEVEL : level];
+
+} // end levelSpeedOf
+
+
+/////////////////////////////////////////////////////
+//  renderHud - Void - brings the level and score along the top up to date, only the
+//              glyphs that changed are sent to the LCD
+//  Arguments: game - game to draw
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+static void renderHud(gameContext *game) {
+
+    char text[FONT_TEXT_MAX+1]; // Text of a HUD field
+
+    //Level counts from 1, and stays at the last one once the game is won
+    strcpy(text, "LEVEL ");
+    fontNumber(text+strlen(text), ((game->level>END_LEVEL) ? END_LEVEL : game->level) + 1);
+    fontTextDraw(&game->levelText, text);
+
+    //Score is every hit of the game so far
+    strcpy(text, "SCORE ");
+    fontNumber(text+strlen(text), game->level*HITS_PER_LEVEL + game->hitsCounter);
+    fontTextDraw(&game->scoreText, text);
+
+} // end renderHud
+
+
+/////////////////////////////////////////////////////
+//  addBalls - Void - adds balls until there are as many as the level has, each one
+//             BALL_Y_STAGGER above the spawn so it arrives after the ball just spawned
+//  Arguments: game - game to add balls to
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+static void addBalls(gameContext *game) {
+
+    while(game->level<=END_LEVEL && game->ballCount<levelBalls[game->level]) {
+        ballSpawn(game, game->ballCount);
+        if(game->ballCount>0) {
+            game->ballPosY[game->ballCount] += FIX(BALL_Y_STAGGER);
+            game->ballY[game->ballCount] += BALL_Y_STAGGER;
+        }
+        game->ballCount++;
+    } // end while: balls to add
+
+} // end addBalls
+
+
+/////////////////////////////////////////////////////
+//  accelerateBalls - Void - changes the speed of every ball in play, keeping its direction
+//  Arguments:
+//      game - game the balls belong to
+//      oldSpeed, newSpeed - speed the balls move at now and the one they change to
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+static void accelerateBalls(gameContext *game, int oldSpeed, int newSpeed) {
+
+    int ball;
+
+    for(ball=0; ball<game->ballCount; ball++) {
+        game->ballVelX[ball] = game->ballVelX[ball] * newSpeed / oldSpeed;
+        game->ballVelY[ball] = game->ballVelY[ball] * newSpeed / oldSpeed;
+    } // end for: balls
+
+} // end accelerateBalls
+
+
+/////////////////////////////////////////////////////
+//  gameInit - Void - (re)initializes all game parameters, the screen is cleared on the next render
+//  Arguments: game - game to initialize
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void gameInit(gameContext *game) {
+
+    game->clearColour = BG_COLOR;       // Set LCD to CYAN background on next render
+    fontTextInit(&game->levelText, HUD_LEVEL_X, HUD_TEXT_Y, HUD_TEXT, HUD_BG); // HUD drawn with the clear
+    fontTextInit(&game->scoreText, HUD_SCORE_X, HUD_TEXT_Y, HUD_TEXT, HUD_BG);
+    game->hitsCounter=0;                // counter that keeps track of how many hits
+    game->level=START_LEVEL;            // counter that keeps track of level - starts at 0, ends at 4, increments every 10 hits
+    game->pedalX_Last = PEDAL_NONE;     // no pedal until the first update
+    game->ballCount=0;                  // Initialize the ball spawn, as many balls as the level has
+    addBalls(game);
+    game->gameState = GAME_ON;          // turn state of game as on
+
+} // end gameInit
+
+
+/////////////////////////////////////////////////////
+//  ballSpawn - Void - respawns a ball at the top of the screen
+//  Arguments:
+//      game - game the ball belongs to
+//      ball - index of the ball
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void ballSpawn(gameContext *game, int ball) {
+
+    int direction, angle; // Swing of the ball, left or right, and how steep
+
+    game->ballY[ball] = BALL_Y_SPAWN; // Put ball back at top
+    game->ballX[ball] = BALL_X_START_MIN + prngBelow(&game->rng, BALL_X_START_RANGE); //Randomizes ball x starting location
+    direction = BALL_X_LEFT + BALL_X_DIRECTIONS * prngBelow(&game->rng, BALL_X_DIRECTIONS); // Randomizes ballx direction (or the swing)
+    angle = prngBelow(&game->rng, BALL_X_ANGLE); // Randomizes the angle ballx takes
+
+    game->ballPosX[ball] = FIX(game->ballX[ball]);
+    game->ballPosY[ball] = FIX(game->ballY[ball]);
+    game->ballVelY[ball] = -levelSpeedOf(game->level); // Falling at the speed of the level
+    game->ballVelX[ball] = direction * levelSpeedOf(game->level) / (BALL_X_SLOPE * (angle+1)); // 1 sideways per 7 down at the steepest
+
+} // end ballSpawn
+
+
+/////////////////////////////////////////////////////
+//  gameUpdate - Void - advances the game by one tick: moves the balls, checks for hits
+//               and misses, keeps score and changes level. Does not touch the screen
+//  Arguments: game - game to advance (pedalX must hold the latest input)
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void gameUpdate(gameContext *game) {
+
+    int startX[BALLS_MAX], startY[BALLS_MAX]; // Balls before this tick's move, for the hit collision detector
+    int pedalLast, pedalNow;    // Center of the pedal at the last update and now, Q8.8
+    int contact;                // Time in the move the ball touched the pedal, Q8.8
+    int offset;                 // Where on the pedal it touched, from the center
+    int ball;                   // Ball being updated
+    int count;                  // Balls in play at the start of the tick, a ball added by a level up waits for the next
+
+    //Make sure game is on!
+    if(game->gameState != GAME_ON)
+        return;
+
+    //The pedal moves from where it was at the last update to where it is now, along with the balls
+    if(game->pedalX_Last == PEDAL_NONE)
+        game->pedalX_Last = game->pedalX;
+    pedalLast = FIX(game->pedalX_Last);
+    pedalNow = FIX(game->pedalX);
+    game->pedalX_Last = game->pedalX;
+
+    memcpy(startX, game->ballPosX, sizeof(startX));
+    memcpy(startY, game->ballPosY, sizeof(startY));
+    count = game->ballCount;
+
+    //Move every ball by its velocity
+    for(ball=0; ball<game->ballCount; ball++) {
+        game->ballPosX[ball] += game->ballVelX[ball];
+        game->ballPosY[ball] += game->ballVelY[ball];
+    } // end for: move
+
+    //Bounce off the sides of the screen, and off the top of the field on the way up
+    for(ball=0; ball<game->ballCount; ball++) {
+        if(game->ballPosX[ball] < FIX(LCD_MIN+BALL_RADIUS) && game->ballVelX[ball] < 0) {
+            game->ballPosX[ball] = 2*FIX(LCD_MIN+BALL_RADIUS) - game->ballPosX[ball];
+            game->ballVelX[ball] = -game->ballVelX[ball];
+        } else if(game->ballPosX[ball] > FIX(LCD_MAX-BALL_RADIUS) && game->ballVelX[ball] > 0) {
+            game->ballPosX[ball] = 2*FIX(LCD_MAX-BALL_RADIUS) - game->ballPosX[ball];
+            game->ballVelX[ball] = -game->ballVelX[ball];
+        } // end if: sides
+        if(game->ballPosY[ball] > FIX(FIELD_MAX-BALL_RADIUS) && game->ballVelY[ball] > 0) {
+            game->ballPosY[ball] = 2*FIX(FIELD_MAX-BALL_RADIUS) - game->ballPosY[ball];
+            game->ballVelY[ball] = -game->ballVelY[ball];
+        } // end if: top
+    } // end for: bounces
+
+    //Hit collision detector, the move of every ball this tick against the pedal, so no move is too big to catch
+    for(ball=0; ball<count; ball++) {
+
+        //Check to see if ball came down on the pedal at any point of its move, seen from the moving pedal
+        //(the pedal and the pixels around it, so a ball touching the pedal is drawn next to it rather than over it)
+        contact = collideCircleRect(startX[ball]-pedalLast, startY[ball], game->ballPosX[ball]-pedalNow, game->ballPosY[ball],
+                                    FIX(BALL_RADIUS), -FIX(PEDAL_WIDTH+1), FIX(PEDAL_Y), FIX(PEDAL_WIDTH+1),
+                                    FIX(PEDAL_Y+PEDAL_HEIGHT));
+        if(contact == COLLIDE_NONE)
+            continue;
+
+        //Bounce back up from where it touched, further to the side the further from the center it hit
+        offset = (startX[ball]-pedalLast) + ((game->ballPosX[ball]-pedalNow) - (startX[ball]-pedalLast)) * contact / FIX_ONE;
+        game->ballPosX[ball] = startX[ball] + (game->ballPosX[ball]-startX[ball]) * contact / FIX_ONE;
+        game->ballPosY[ball] = startY[ball] + (game->ballPosY[ball]-startY[ball]) * contact / FIX_ONE;
+        if(offset > FIX(PEDAL_WIDTH+BALL_RADIUS))
+            offset = FIX(PEDAL_WIDTH+BALL_RADIUS);
+        else if(offset < -FIX(PEDAL_WIDTH+BALL_RADIUS))
+            offset = -FIX(PEDAL_WIDTH+BALL_RADIUS);
+        game->ballVelX[ball] = levelSpeedOf(game->level) * offset / FIX(PEDAL_WIDTH+BALL_RADIUS); // 45 degrees at the ends
+        game->ballVelY[ball] = levelSpeedOf(game->level);
+
+        //increment hits counter, if it reaches to 10, reset hits counter and increment level
+        game->hitsCounter++;
+        if(game->hitsCounter>=HITS_PER_LEVEL) {
+
+            game->hitsCounter=0; //reset hits counter
+            game->level++; // increment level
+
+            //If level max is overcome, you have won the game - so clear LCD and turn game off
+            if(game->level>END_LEVEL) {
+                game->clearColour = GREEN;
+                game->gameState=GAME_OFF;
+                return;
+            } // end if: end game
+
+            //Every ball speeds up to the new level's speed, and higher levels have more balls
+            accelerateBalls(game, levelSpeed[game->level-1], levelSpeed[game->level]);
+            addBalls(game);
+        } // end if: hits Counter reset
+    } // end for: hit collision detector
+
+    //Pixels the balls are drawn at
+    for(ball=0; ball<game->ballCount; ball++) {
+        game->ballX[ball] = FIX_PIXEL(game->ballPosX[ball]);
+        game->ballY[ball] = FIX_PIXEL(game->ballPosY[ball]);
+    } // end for: pixels
+
+    //If any ball reaches bottom, game over
+    for(ball=0; ball<game->ballCount; ball++) {
+        if(game->ballY[ball]<=BALL_Y_BOTTOM) {
+
+            //Clear screen and game, game has been lost
+            game->clearColour = RED;
+            game->gameState=GAME_OFF;
+
+        } // end if: ball reaches bottom
+    } // end for: balls reaching bottom
+
+} // end gameUpdate
+
+
+/////////////////////////////////////////////////////
+//  gameRender - Void - brings the screen up to date with the game, only repainting what changed
+//  Arguments: game - game to draw
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void gameRender(gameContext *game) {
+
+    int ball;   // Ball being checked
+    int moved;  // Set if any ball moved
+    int lowest; // Lowest ball, before or after the move
+
+    //Screen cleared (new game or end of game): nothing of the old frame is left
+    if(game->clearColour != NO_CLEAR) {
+
+        lcdClear(game->clearColour);
+        game->clearColour = NO_CLEAR;
+        game->pedalX_Drawn = PEDAL_NONE;
+        game->ballCount_Drawn = 0;
+
+        //End screens only show the balls and the HUD, a new game starts with the pedal and no ball
+        if(game->gameState != GAME_ON) {
+            for(ball=0; ball<game->ballCount; ball++) {
+                writeBall(game->ballX[ball], game->ballY[ball], WRITE);
+                game->ballX_Drawn[ball] = game->ballX[ball];
+                game->ballY_Drawn[ball] = game->ballY[ball];
+            } // end for: balls
+            game->ballCount_Drawn = game->ballCount;
+        } // end if: end screen
+
+        //HUD bar along the top, over any ball reaching past FIELD_MAX, its text is drawn again below
+        lcdFillRect(LCD_MIN, HUD_Y0, LCD_MAX, LCD_MAX, HUD_BG);
+        fontTextForget(&game->levelText);
+        fontTextForget(&game->scoreText);
+
+        //The end screen is finished with the HUD text
+        if(game->gameState != GAME_ON) {
+            renderHud(game);
+            return;
+        }
+    } // end if: screen cleared
+
+    //Only draw while the game is on
+    if(game->gameState != GAME_ON)
+        return;
+
+    //If there is a change in the x value of the pedal, write a new pedal
+    if(game->pedalX != game->pedalX_Drawn) {
+        writePedal(game->pedalX, game->pedalX_Drawn);
+        game->pedalX_Drawn = game->pedalX;
+    } // end if: pedal moved
+
+    //Balls not drawn yet (new game or added by the level) are off the top of the screen
+    for(ball=game->ballCount_Drawn; ball<game->ballCount; ball++) {
+        game->ballX_Drawn[ball] = game->ballX[ball];
+        game->ballY_Drawn[ball] = BALL_Y_HIDDEN;
+    } // end for: balls not drawn
+    game->ballCount_Drawn = game->ballCount;
+
+    //If any ball moved, repaint what changed of all of them at once (they may overlap)
+    moved = 0;
+    lowest = LCD_MAX;
+    for(ball=0; ball<game->ballCount; ball++) {
+        if(game->ballX[ball] != game->ballX_Drawn[ball] || game->ballY[ball] != game->ballY_Drawn[ball])
+            moved = 1;
+        if(game->ballY[ball] < lowest)
+            lowest = game->ballY[ball];
+        if(game->ballY_Drawn[ball] < lowest)
+            lowest = game->ballY_Drawn[ball];
+    } // end for: balls moved
+    if(moved) {
+        moveBalls(game->ballCount, game->ballX_Drawn, game->ballY_Drawn, game->ballX, game->ballY);
+        memcpy(game->ballX_Drawn, game->ballX, sizeof(game->ballX));
+        memcpy(game->ballY_Drawn, game->ballY, sizeof(game->ballY));
+
+        //A missed ball falling past the pedal rows may have been drawn or erased over the pedal
+        if((lowest-BALL_RADIUS) < SCROLL_Y0)
+            writePedal(game->pedalX, PEDAL_NONE);
+    } // end if: ball moved
+
+    //Level and score, nothing is sent unless they changed
+    renderHud(game);
+
+} // end gameRender
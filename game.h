@@ -0,0 +1,116 @@
+//  game.h - Game state, with the update and render steps of the main loop
+//  Author: Jimmy Bates
+//  Set: T
+//  Date: December 2, 2020
+
+#ifndef GAME_H_
+#define GAME_H_
+
+#include "font.h"
+#include "prng.h"
+
+// Dimensions and measurements
+
+#define BALL_Y_SPAWN        (129+BALL_RADIUS)       // The Y value the ball spawns
+#define BALL_Y_BOTTOM       (LCD_MIN-BALL_RADIUS)   // The lowest Y value the ball drops
+
+#define BALL_X_START_RANGE  (92-BALL_RADIUS)        // This gets multiplied by random
+#define BALL_X_START_MIN    (18+BALL_RADIUS)        // Lowest value ballX can START
+
+#define BALL_Y_STAGGER      63                      // Height above the spawn a ball added by a level starts at
+#define BALL_Y_HIDDEN       (BALL_Y_SPAWN+2*BALL_RADIUS+1)  // Off the top of the screen, where a ball not drawn yet is
+
+#define BALL_X_ANGLE        5                       // Different angles it can go
+#define BALL_X_DIRECTIONS   2                       // 2 directions
+#define BALL_X_LEFT         -1                      // Ball is going left
+#define BALL_X_SLOPE        7                       // Pixels a new ball drops per pixel sideways at its steepest angle
+
+// States
+
+#define GAME_ON         1                   //  Meaning game continue
+#define GAME_OFF        0                   //  Meaning game end
+#define GAME_PAUSED     2                   //  Meaning game paused by S1, resumed by S1 again
+
+#define START_LEVEL     0                   // Start level
+#define END_LEVEL       4                   // End level
+
+#define HITS_PER_LEVEL  5                  // Amount of hits before level decrements
+
+#define NO_CLEAR        -1                  // clearColour when the screen doesn't need clearing
+
+// HUD
+
+#define HUD_LEVEL_X     1                   // Left of the level text
+#define HUD_SCORE_X     67                  // Left of the score text, room for 10 cells up to the right edge
+#define HUD_TEXT_Y      (HUD_Y0+1)          // Bottom of the HUD text
+
+// Timings
+
+#define DROP_INTERVAL   6250                // Period for ball drop timer (30 ticks a second at every level, the balls speed up instead)
+
+// Everything about one game. Changed by gameUpdate, drawn by gameRender
+// The balls are kept as one array per field (indexed by ball), so each step of the
+// update runs over one field of every ball in a tight loop. Positions and velocities
+// are Q8.8 fixed point (see collide.h), ballX/ballY are the pixels they round to
+typedef struct {
+    int ballCount;                      // Balls in play, set by the level
+    int ballPosX[BALLS_MAX];            // Center of ball, Q8.8
+    int ballPosY[BALLS_MAX];
+    int ballVelX[BALLS_MAX];            // Pixels the ball moves per tick, Q8.8
+    int ballVelY[BALLS_MAX];            // up is positive, -levelSpeed falling and +levelSpeed rising
+    int ballY[BALLS_MAX];               // Y value for center of ball
+    int ballX[BALLS_MAX];               // X value for center of ball
+    int pedalX;                 // x value of Joystick, converted into LCD, for the center of the pedal
+    int pedalX_Last;            // pedalX at the last update, PEDAL_NONE before the first
+    int gameState;              // Determines whether game is still on, over or paused
+    int hitsCounter;            // counter that keeps track of how many hits
+    int level;                  // counter that keeps track of level - starts at 0, ends at 4, increments every 10 hits
+
+    int clearColour;            // colour the screen is cleared to before the next render, NO_CLEAR if none
+    int ballCount_Drawn;        // balls and pedal currently on screen (what gameRender last drew)
+    int ballX_Drawn[BALLS_MAX];
+    int ballY_Drawn[BALLS_MAX];
+    int pedalX_Drawn;           // PEDAL_NONE if no pedal on screen
+    fontText levelText;         // HUD text on screen, only changed glyphs are redrawn
+    fontText scoreText;
+
+    prngState rng;              // numbers the balls are spawned with, seeded by the caller (gameInit leaves it as it is)
+} gameContext;
+
+
+/////////////////////////////////////////////////////
+//  gameInit - Void - (re)initializes all game parameters, the screen is cleared on the next render
+//  Arguments: game - game to initialize
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void gameInit(gameContext *game);
+
+
+/////////////////////////////////////////////////////
+//  ballSpawn - Void - respawns a ball at the top of the screen
+//  Arguments:
+//      game - game the ball belongs to
+//      ball - index of the ball
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void ballSpawn(gameContext *game, int ball);
+
+
+/////////////////////////////////////////////////////
+//  gameUpdate - Void - advances the game by one tick: drops the ball, checks for a hit
+//               or a miss, keeps score and changes level. Does not touch the screen
+//  Arguments: game - game to advance (pedalX must hold the latest input)
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void gameUpdate(gameContext *game);
+
+
+/////////////////////////////////////////////////////
+//  gameRender - Void - brings the screen up to date with the game, only repainting what changed
+//  Arguments: game - game to draw
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void gameRender(gameContext *game);
+
+
+#endif /* GAME_H_ */
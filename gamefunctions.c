@@ -3,11 +3,259 @@
 //  Set: T
 //  Date: December 2, 2020
 
-#include "msp.h"
+#include "hal.h"
 #include "gamefunctions.h"
 #include "lcd.h"
 #include "adc.h"
-#include <math.h>
+
+#define NO_PIXEL        -1                  //  Colour given by a sprite for pixels it does not cover
+#define DIRTY_MERGE_GAP 5                   //  Unchanged pixels resent to join two changed spans (cheaper than a new window)
+
+// Shape of a sprite drawn by the dirty region renderer
+typedef struct {
+    int left, right;                        //  Columns covered left/right of the sprite position
+    int bottom, top;                        //  Rows covered below/above the sprite position
+    int (*colourAt)(int dx, int dy);        //  Colour at an offset from the sprite position, NO_PIXEL if not covered
+} spriteShape;
+
+// Sprites of one shape on the screen at once
+typedef struct {
+    const spriteShape *shape;
+    int count;                              //  Sprites drawn
+    const int *x, *y;                       //  Position of each
+} spriteScene;
+
+static int pedalColourAt(int dx, int dy);
+static int ballColourAt(int dx, int dy);
+
+// Ball sprite, one vertical span per column (built once by ballSpriteInit)
+static signed char ballSpanHalf[2*BALL_RADIUS+1];      //  Half height of the ball column (rows -half to +half)
+static signed char ballInsideHalf[2*BALL_RADIUS+1];    //  Half height of the white inside of the column, -1 if all outline
+
+// Joystick conversion is done in fixed point, deflection from centre is 0-256 (Q8) either side
+#define JS_Q8_ONE       256                     //  Full deflection
+#define JS_CURVE_STEP   (JS_Q8_ONE/(JS_CURVE_POINTS-1))
+#define JS_SCALE(span)  ((JS_Q8_ONE<<16)/(span)) //  Q16 factor turning ADC counts into deflection
+
+// Current JS calibration, and its per side scale factors
+static jsCalibration jsCal = { JS_MIN, JS_MAX, JS_CENTRE, 0, 0 };
+static int jsScaleLeft = JS_SCALE(JS_CENTRE-JS_MIN);
+static int jsScaleRight = JS_SCALE(JS_MAX-JS_CENTRE);
+
+const unsigned short jsCurveFine[JS_CURVE_POINTS] = {
+    0, 2, 8, 18, 32, 50, 72, 98, 128, 150, 171, 190, 207, 222, 235, 246, 256
+};
+
+static const spriteShape pedalShape = { PEDAL_WIDTH, PEDAL_WIDTH, 0, PEDAL_HEIGHT-1, pedalColourAt };
+static const spriteShape ballShape = { BALL_RADIUS, BALL_RADIUS, BALL_RADIUS, BALL_RADIUS, ballColourAt };
+
+
+/////////////////////////////////////////////////////
+//  pedalColourAt - Colour of the pedal at an offset from its position
+//  Arguments: dx, dy - offset from the center of the bottom row of the pedal
+//  Return value: colour of the pixel
+/////////////////////////////////////////////////////
+static int pedalColourAt(int dx, int dy) {
+
+    // Top row and 2px either side are outline, rest is inside
+    if(dy==(PEDAL_HEIGHT-1) || dx<=(0-PEDAL_WIDTH+1) || dx>=(PEDAL_WIDTH-1))
+        return PEDAL_OUTLINE;
+
+    return PEDAL_INSIDE;
+
+} // end pedalColourAt
+
+
+/////////////////////////////////////////////////////
+//  ballColourAt - Colour of the ball at an offset from its center (from the ball sprite)
+//  Arguments: dx, dy - offset from the center of the ball
+//  Return value: colour of the pixel, or NO_PIXEL if outside the ball
+/////////////////////////////////////////////////////
+static int ballColourAt(int dx, int dy) {
+
+    int absY = (dy<0) ? -dy : dy;
+
+    // Inside of the column span is white, rest of the span is the outline
+    if(absY<=ballInsideHalf[dx+BALL_RADIUS])
+        return BALL_INSIDE;
+    if(absY<=ballSpanHalf[dx+BALL_RADIUS])
+        return BALL_OUTLINE;
+
+    return NO_PIXEL;
+
+} // end ballColourAt
+
+
+/////////////////////////////////////////////////////
+//  scenePixel - Colour a pixel of the screen should be with a scene of sprites drawn
+//  Arguments:
+//      scene - sprites drawn, the first one covering the pixel gives its colour
+//      x, y - pixel of the screen
+//  Return value: colour of the pixel (background if not covered by any sprite)
+/////////////////////////////////////////////////////
+static int scenePixel(const spriteScene *scene, int x, int y) {
+
+    const spriteShape *shape = scene->shape;
+    int sprite;     // Sprite checked
+    int dx, dy;     // Offset of the pixel from the sprite position
+    int colour;
+
+    for(sprite=0; sprite<scene->count; sprite++) {
+
+        dx = x - scene->x[sprite];
+        dy = y - scene->y[sprite];
+
+        if(dx<(0-shape->left) || dx>shape->right || dy<(0-shape->bottom) || dy>shape->top)
+            continue;
+
+        colour = shape->colourAt(dx, dy);
+        if(colour!=NO_PIXEL)
+            return colour;
+
+    } // end for: sprites
+
+    return BG_COLOR;
+
+} // end scenePixel
+
+
+/////////////////////////////////////////////////////
+//  drawDirtyRegion - Void - repaints the pixels of a region that change between two scenes
+//                    Each column is scanned for spans of changed pixels, which are
+//                    sent through a one column window
+//  Arguments:
+//      oldScene - sprites currently on screen
+//      newScene - sprites to draw instead
+//      x0, y0, x1, y1 - region to repaint
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+static void drawDirtyRegion(const spriteScene *oldScene, const spriteScene *newScene, int x0, int y0, int x1, int y1) {
+
+    int xIndex, yIndex;         // Pixel being checked
+    int spanStart, spanEnd;     // Changed span of the current column
+    int gap;                    // Unchanged pixels since the end of the span
+    int runColour, runLength;   // Run of equal colour pixels being streamed
+    int colour;
+
+    // Clip region to the play field (the LCD below the HUD)
+    if(x0<LCD_MIN) x0 = LCD_MIN;
+    if(y0<LCD_MIN) y0 = LCD_MIN;
+    if(x1>LCD_MAX) x1 = LCD_MAX;
+    if(y1>FIELD_MAX) y1 = FIELD_MAX;
+
+    // X array of region
+    for(xIndex=x0; xIndex<=x1; xIndex++) {
+
+        yIndex = y0;
+        while(yIndex<=y1) {
+
+            // Skip pixels that stay the same
+            if(scenePixel(oldScene, xIndex, yIndex) == scenePixel(newScene, xIndex, yIndex)) {
+                yIndex++;
+                continue;
+            }
+
+            // Grow span over changed pixels, joining spans separated by a short gap
+            spanStart = yIndex;
+            spanEnd = yIndex;
+            for(yIndex=spanStart+1, gap=0; yIndex<=y1 && gap<=DIRTY_MERGE_GAP; yIndex++) {
+                if(scenePixel(oldScene, xIndex, yIndex) != scenePixel(newScene, xIndex, yIndex)) {
+                    spanEnd = yIndex;
+                    gap = 0;
+                } else {
+                    gap++;
+                }
+            } // end for: grow span
+            yIndex = spanEnd+1;
+
+            // Stream the new colours of the span as runs
+            lcdSetWindow(xIndex, spanStart, xIndex, spanEnd);
+            runColour = scenePixel(newScene, xIndex, spanStart);
+            runLength = 1;
+            for(spanStart++; spanStart<=spanEnd; spanStart++) {
+                colour = scenePixel(newScene, xIndex, spanStart);
+                if(colour==runColour) {
+                    runLength++;
+                } else {
+                    lcdPushPixels(runColour, runLength);
+                    runColour = colour;
+                    runLength = 1;
+                }
+            } // end for: stream span
+            lcdPushPixels(runColour, runLength);
+
+        } // end while: Y array of region
+    } // end for: X array of region
+
+} // end drawDirtyRegion
+
+
+/////////////////////////////////////////////////////
+//  drawSpriteMove - Void - moves one sprite of a scene, only repainting pixels that change
+//                   (pixels of the other sprites are repainted too where they are in the way)
+//  Arguments:
+//      oldScene - sprites currently on screen
+//      newScene - sprites to draw instead
+//      sprite - sprite being moved, from the old scene (if it has it) to the new one
+//      rowMin, rowMax - rows of the screen repainted, the rest are left alone
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+static void drawSpriteMove(const spriteScene *oldScene, const spriteScene *newScene, int sprite, int rowMin, int rowMax) {
+
+    const spriteShape *shape = newScene->shape;
+    int oldVisible = (sprite<oldScene->count);
+    int oldX = oldVisible ? oldScene->x[sprite] : 0, oldY = oldVisible ? oldScene->y[sprite] : 0;
+    int newX = newScene->x[sprite], newY = newScene->y[sprite];
+
+    // Footprints of old and new sprite
+    int oldX0 = oldX-shape->left, oldX1 = oldX+shape->right, oldY0 = oldY-shape->bottom, oldY1 = oldY+shape->top;
+    int newX0 = newX-shape->left, newX1 = newX+shape->right, newY0 = newY-shape->bottom, newY1 = newY+shape->top;
+
+    // Keep to the rows asked for
+    if(oldY0<rowMin) oldY0 = rowMin;
+    if(newY0<rowMin) newY0 = rowMin;
+    if(oldY1>rowMax) oldY1 = rowMax;
+    if(newY1>rowMax) newY1 = rowMax;
+
+    // IF: footprints overlap, repaint the changes over both at once
+    if(oldVisible && oldX0<=newX1 && newX0<=oldX1 && oldY0<=newY1 && newY0<=oldY1) {
+
+        drawDirtyRegion(oldScene, newScene,
+                        (oldX0<newX0) ? oldX0 : newX0, (oldY0<newY0) ? oldY0 : newY0,
+                        (oldX1>newX1) ? oldX1 : newX1, (oldY1>newY1) ? oldY1 : newY1);
+
+    // Otherwise, erase the old and draw the new separately
+    } else {
+
+        if(oldVisible)
+            drawDirtyRegion(oldScene, newScene, oldX0, oldY0, oldX1, oldY1);
+
+        drawDirtyRegion(oldScene, newScene, newX0, newY0, newX1, newY1);
+
+    } // end if: footprints overlap
+
+} // end drawSpriteMove
+
+
+/////////////////////////////////////////////////////
+//  jsCalibrate - Sets the calibration used by jsLcdConv (defaults to JS_MIN-JS_MAX, no dead zone, linear)
+//  Arguments: calibration - new calibration (copied)
+//  Return value: none
+/////////////////////////////////////////////////////
+void jsCalibrate(const jsCalibration *calibration) {
+
+    int spanLeft, spanRight; // ADC counts from the edge of the dead zone to the end of each side
+
+    jsCal = *calibration;
+
+    spanLeft = jsCal.adcCentre - jsCal.deadZone - jsCal.adcMin;
+    spanRight = jsCal.adcMax - jsCal.adcCentre - jsCal.deadZone;
+
+    // Divide once here so jsLcdConv only multiplies and shifts
+    jsScaleLeft = (spanLeft>0) ? JS_SCALE(spanLeft) : 0;
+    jsScaleRight = (spanRight>0) ? JS_SCALE(spanRight) : 0;
+
+} // end jsCalibrate
 
 
 /////////////////////////////////////////////////////
@@ -17,57 +265,102 @@
 /////////////////////////////////////////////////////
 int jsLcdConv(int adcValue) {
 
+    int offset;     // ADC counts away from centre, outside of the dead zone
+    int deflection; // Deflection from centre, 0-256 (Q8)
+    int point;      // Curve point below the deflection
+
     // Adjust boundaries of ADC so we don't get LCD values below 0 or above 127
-    if(adcValue<JS_MIN) {
-        adcValue=JS_MIN;
-    } else if(adcValue>JS_MAX) {
-        adcValue=JS_MAX;
+    if(adcValue<jsCal.adcMin) {
+        adcValue=jsCal.adcMin;
+    } else if(adcValue>jsCal.adcMax) {
+        adcValue=jsCal.adcMax;
     } // end boundaries if-else
 
-    // Return Equation of JS to ADC equation, round so it doesn't truncate
-    return round((adcValue - JS_MIN) * (LCD_MAX - LCD_MIN) / (JS_MAX - JS_MIN));
+    // Dead zone around the centre
+    offset = adcValue - jsCal.adcCentre;
+    if(offset>jsCal.deadZone) {
+        offset -= jsCal.deadZone;
+        deflection = (offset * jsScaleRight) >> 16;
+    } else if(offset<(0-jsCal.deadZone)) {
+        offset = 0-offset-jsCal.deadZone;
+        deflection = (offset * jsScaleLeft) >> 16;
+    } else {
+        deflection = 0;
+    } // end dead zone if-else
+
+    if(deflection>JS_Q8_ONE)
+        deflection = JS_Q8_ONE;
+
+    // Apply response curve, interpolating between its points
+    if(jsCal.curve && deflection<JS_Q8_ONE) {
+        point = deflection / JS_CURVE_STEP;
+        deflection = jsCal.curve[point] + ((jsCal.curve[point+1] - jsCal.curve[point]) * (deflection % JS_CURVE_STEP)) / JS_CURVE_STEP;
+    } else if(jsCal.curve) {
+        deflection = jsCal.curve[JS_CURVE_POINTS-1];
+    } // end curve if
+
+    // Left of centre moves the pedal left
+    if(adcValue<jsCal.adcCentre)
+        deflection = 0-deflection;
+
+    // Centre of the LCD plus deflection, rounded so it doesn't truncate
+    return LCD_MIN + (((LCD_MAX - LCD_MIN) * (JS_Q8_ONE + deflection) + JS_Q8_ONE) >> 9);
 
 } // end jsLcdConv
 
 
 /////////////////////////////////////////////////////
 //  writePedal - Void - writes the pedal on the screen based on the input x value from JS
+//               Only the pixels that differ between the previous and new pedal are sent to the LCD
 //  Arguments:
 //      pedalX - current JS value from ADC;
-//      pedalX_Prev - previous JS value from ADC (to erase)
+//      pedalX_Prev - previous JS value from ADC (to erase), PEDAL_NONE if no pedal is on screen
 //  Return value: none allowed
 /////////////////////////////////////////////////////
 void writePedal(int pedalX, int pedalX_prev) {
 
-    int xIndex; // Keep track of X value of LCD writing of pedal (pedalX-10 - pedalX+10)
-    int yIndex; // Keep track of Y value of LCD writing of pedal (LCD_MIN - LCD_MIN+4)
+    int pedalY = PEDAL_Y;
+    spriteScene oldPedal = { &pedalShape, (pedalX_prev!=PEDAL_NONE), &pedalX_prev, &pedalY };
+    spriteScene newPedal = { &pedalShape, 1, &pedalX, &pedalY };
 
-    int pedalColour; // Holds value of what colour pixel should be written for pedal (if border, black, else red)
+    // Repaint only what changed between the previous and new pedal
+    drawSpriteMove(&oldPedal, &newPedal, 0, LCD_MIN, LCD_MAX);
 
-    // Write Y array of pedal
-    for(yIndex=PEDAL_Y; yIndex<(PEDAL_Y+PEDAL_HEIGHT); yIndex++) {
+} // end writePedal
 
-        // Erase previous line
-        for(xIndex=(pedalX_prev-PEDAL_WIDTH); xIndex<=(pedalX_prev+PEDAL_WIDTH); xIndex++) {
-            lcdSetPixel(xIndex, yIndex, BG_COLOR); // Write to LCD the pixel of BG colour to previous pedal
-        } // end pedalX_prev for
 
-        // Write X array of pedal
-        for(xIndex=(pedalX-PEDAL_WIDTH); xIndex<=(pedalX+PEDAL_WIDTH); xIndex++) {
+/////////////////////////////////////////////////////
+//  ballSpriteInit - Void - builds the ball sprite used by writeBall and moveBall, and sets
+//                   the LCD scroll area moveBalls drops the balls with
+//  Arguments: none
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void ballSpriteInit(void) {
 
+    int xIndex, span; // Column of the ball and its half height
 
-           // IF: pixel is not on border, red
-           if(xIndex>(pedalX-PEDAL_WIDTH+1) && xIndex<(pedalX+PEDAL_WIDTH-1) && yIndex<(PEDAL_Y+PEDAL_HEIGHT-1))
-               pedalColour = PEDAL_INSIDE;
-           // Otherwise, write the outline which is black
-           else
-               pedalColour = PEDAL_OUTLINE;
+    // X array for Ball
+    for(xIndex=(0-BALL_RADIUS); xIndex<=(BALL_RADIUS); xIndex++) {
 
-           lcdSetPixel(xIndex, yIndex, pedalColour); // Write to LCD the pixel of pedal pixel
+        // Tallest half height that stays within the radius (integer square root)
+        span = 0;
+        while((xIndex*xIndex) + (span+1)*(span+1) <= BALL_RADIUS*BALL_RADIUS)
+            span++;
 
-        } // end X array for current pedal for
-    } // end Y array pedal for
-} // end writePedal
+        ballSpanHalf[xIndex+BALL_RADIUS] = span;
+
+        // 2px outline on every side, so the 2 outer columns and top/bottom 2 rows have no inside
+        if(xIndex>=(BALL_RADIUS-1) || xIndex<=(0-BALL_RADIUS+1) || span<2)
+            ballInsideHalf[xIndex+BALL_RADIUS] = -1;
+        else
+            ballInsideHalf[xIndex+BALL_RADIUS] = span-2;
+
+    } // end for: X array for Ball
+
+    // Play field between the pedal and the HUD scrolls, they stay put
+    lcdScrollArea(SCROLL_Y0, FIELD_MAX);
+
+} // end ballSpriteInit
 
 
 /////////////////////////////////////////////////////
@@ -80,46 +373,116 @@ void writePedal(int pedalX, int pedalX_prev) {
 /////////////////////////////////////////////////////
 void writeBall(int ballX, int ballY, int ballErase) {
 
-    signed int ballColour, ballY_Max, xIndex, yIndex; // Declare variables for ball parameters
+    int xIndex, span, inside; // Column of the ball and its half heights from the sprite
 
     // X array for Ball
     for(xIndex=(0-BALL_RADIUS); xIndex<=(BALL_RADIUS); xIndex++) {
 
-        // Calculate value for Y MIN and Y MAX (Y MIN just equals negative Y MAX)
-        ballY_Max=sqrt(( BALL_RADIUS * BALL_RADIUS ) - ( xIndex * xIndex ));
-
-        // Y array for Ball
-        for(yIndex=(0-ballY_Max); yIndex<=ballY_Max; yIndex++) {
+        span = ballSpanHalf[xIndex+BALL_RADIUS];
+        inside = ballInsideHalf[xIndex+BALL_RADIUS];
 
-            // If function is set to erase, write BG colour to erase
-            if(ballErase==ERASE)
-                ballColour = BG_COLOR;
-            //Else if y index or x index is not on 1px border, ball is white
-            else if( (yIndex<(ballY_Max-1)) && (yIndex>(0-ballY_Max+1)) && (xIndex<(BALL_RADIUS-1)) && (xIndex>(0-BALL_RADIUS+1)) && ballErase==WRITE)
-                ballColour = BALL_INSIDE;
-            //Else, 2px ball outline which is black
-            else
-                ballColour = BALL_OUTLINE;
+        // Set a one column window over this column of the ball, streamed from bottom to top
+        lcdSetWindow( (ballX+xIndex), (ballY-span), (ballX+xIndex), (ballY+span) );
 
-            // Write ball pixels
-            lcdSetPixel( (ballX+xIndex) , (ballY+yIndex), ballColour);
-
-        } // end for: Y array for Ball
+        // If function is set to erase, write BG colour to erase
+        if(ballErase==ERASE)
+            lcdPushPixels(BG_COLOR, 2*span+1);
+        //Else if column has no inside, whole column is black
+        else if(inside<0)
+            lcdPushPixels(BALL_OUTLINE, 2*span+1);
+        //Else, black outline, white inside, black outline
+        else {
+            lcdPushPixels(BALL_OUTLINE, span-inside);
+            lcdPushPixels(BALL_INSIDE, 2*inside+1);
+            lcdPushPixels(BALL_OUTLINE, span-inside);
+        } // end if: ball column colour
 
     } // end for: X array for Ball
 
 }
 
 
+/////////////////////////////////////////////////////
+//  moveBalls - Void - moves the balls on the screen from their old positions to their new ones
+//              Only the pixels that differ between the old and new balls are sent to the LCD
+//              A drop is done by scrolling the play field (everything above SCROLL_Y0, where
+//              the balls must be the only thing drawn) so only the rest of the move is sent
+//  Arguments:
+//      count - balls, at most BALLS_MAX
+//      ballX_Old, ballY_Old - center of each ball currently on screen
+//      ballX, ballY - new center of each ball
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void moveBalls(int count, const int *ballX_Old, const int *ballY_Old, const int *ballX, const int *ballY) {
+
+    int shiftedY[BALLS_MAX];    // Old balls once the play field is scrolled
+    int drop = 0;               // Rows the play field is scrolled down
+    int exposedY;               // Rows above this came in at the top of the play field
+    int ball;
+    spriteScene oldBalls = { &ballShape, count, ballX_Old, ballY_Old };
+    spriteScene newBalls = { &ballShape, count, ballX, ballY };
+    spriteScene noBalls = { &ballShape, 0, ballX, ballY };
+
+    // Scroll as far as the first ball that fell
+    for(ball=0; ball<count && drop==0; ball++) {
+        if(ballY_Old[ball]>ballY[ball])
+            drop = ballY_Old[ball] - ballY[ball];
+    } // end for: first fall
+
+    // Only if every ball is clear of the pedal rows before and after
+    // (rows scrolled off the bottom then only held background)
+    if(drop>(FIELD_MAX-SCROLL_Y0))
+        drop = 0;
+    for(ball=0; ball<count && drop>0; ball++) {
+        shiftedY[ball] = ballY_Old[ball] - drop;
+        if((shiftedY[ball]-BALL_RADIUS)<SCROLL_Y0 || (ballY[ball]-BALL_RADIUS)<SCROLL_Y0)
+            drop = 0;
+    } // end for: clear of the pedal
+
+    // IF: scrolled, the old balls are now drawn lower down, repaint what differs from the new ones
+    if(drop>0 && lcdScroll(drop)) {
+
+        exposedY = FIELD_MAX - drop;
+        oldBalls.y = shiftedY;
+
+        for(ball=0; ball<count; ball++) {
+            // Rows that came in show what left the bottom (background), draw the balls over them
+            drawSpriteMove(&oldBalls, &newBalls, ball, LCD_MIN, exposedY);
+            drawSpriteMove(&noBalls, &newBalls, ball, exposedY+1, FIELD_MAX);
+        } // end for: balls
+
+        return;
+    } // end if: scrolled
+
+    for(ball=0; ball<count; ball++)
+        drawSpriteMove(&oldBalls, &newBalls, ball, LCD_MIN, FIELD_MAX);
+
+} // end moveBalls
+
+
+/////////////////////////////////////////////////////
+//  moveBall - Void - moves a single ball on the screen from its old position to its new one,
+//             see moveBalls
+//  Arguments:
+//      ballX_Old - x value of center of ball currently on screen
+//      ballY_Old - y value of center of ball currently on screen
+//      ballX - new x value of center of ball
+//      ballY - new y value of center of ball
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void moveBall(int ballX_Old, int ballY_Old, int ballX, int ballY) {
+
+    moveBalls(1, &ballX_Old, &ballY_Old, &ballX, &ballY);
+
+} // end moveBall
+
+
 /////////////////////////////////////////////////////
 //  msDelay -- Function to generate delay
 //  Arguments: ms - Number of milliseconds to delay
 //  Return value: none
 /////////////////////////////////////////////////////
 void msDelay(unsigned int ms) {
-    //Delay CLOCKRATE which is 1 millisecond of cycles until ms reaches 0
-    while (ms>0) {
-        __delay_cycles(CLOCKRATE);
-        ms--;
-    }
+    //Busy wait, the HAL knows the clock rate
+    halDelayMs(ms);
 } // End msDelay
@@ -15,6 +15,9 @@
 
 #define JS_MAX          16384               //  Max of JS ADC value
 #define JS_MIN          0                   //  Min of JS ADC value
+#define JS_CENTRE       ((JS_MIN+JS_MAX)/2) //  JS ADC value at rest
+
+#define JS_CURVE_POINTS 17                  //  Points in a JS response curve (evenly spaced, 0 to 256)
 
 // Colours
 
@@ -26,6 +29,9 @@
 #define PEDAL_INSIDE    RED                 // Colour of pedal inside
 #define PEDAL_OUTLINE   BLACK               // Colour of pedal outline
 
+#define HUD_BG          BLACK               // Colour of the HUD bar along the top
+#define HUD_TEXT        WHITE               // Colour of the level and score
+
 // Dimensions and spacing
 
 #define PEDAL_Y         0                   //  POSITION Y of the pedal, to catch the balls
@@ -33,14 +39,43 @@
 #define PEDAL_HEIGHT    3                   //  HEIGHT of pedal from bottom
 
 #define BALL_RADIUS     4                  //  Radius of ball
+#define BALLS_MAX       8                   //  Most balls in play at once
+
+#define HUD_HEIGHT      9                   //  Rows of the HUD bar, a line of text and a row either side
+#define HUD_Y0          (LCD_MAX-HUD_HEIGHT+1)  //  Bottom row of the HUD bar
+#define FIELD_MAX       (HUD_Y0-1)          //  Top row of the play field, the ball goes behind the HUD
+
+#define SCROLL_Y0       PEDAL_HEIGHT        //  Lowest row moveBalls scrolls to drop the balls, the pedal rows below
+                                            //  and the HUD above stay put
 
 // Functional definitions
 
 #define ERASE           1                   //  Erase pedal or ball
 #define WRITE           0                   //  Write pedal or ball
 
+#define PEDAL_NONE      -1                  //  Previous pedal value when there is no pedal on screen
+
 #define DEBOUNCE        10                  //  Define debounce value
-#define CLOCKRATE       3000                //  Define clockrate for msDelay (3E6/1000Hz)
+
+// Joystick calibration used by jsLcdConv
+typedef struct {
+    int adcMin;                             //  ADC value with JS fully left
+    int adcMax;                             //  ADC value with JS fully right
+    int adcCentre;                          //  ADC value with JS at rest
+    int deadZone;                           //  ADC counts either side of centre treated as centre
+    const unsigned short *curve;            //  Response curve of JS_CURVE_POINTS (deflection 0-256 in and out), 0 for linear
+} jsCalibration;
+
+// Response curve with finer control near the centre
+extern const unsigned short jsCurveFine[JS_CURVE_POINTS];
+
+/////////////////////////////////////////////////////
+//  jsCalibrate - Sets the calibration used by jsLcdConv (defaults to JS_MIN-JS_MAX, no dead zone, linear)
+//  Arguments: calibration - new calibration (copied)
+//  Return value: none
+/////////////////////////////////////////////////////
+void jsCalibrate(const jsCalibration *calibration);
+
 
 /////////////////////////////////////////////////////
 //  jsLcdConv - Outputs a value for the LCD screen from the ADC value of the Joystick
@@ -52,14 +87,25 @@ int jsLcdConv(int adcValue);
 
 /////////////////////////////////////////////////////
 //  writePedal - Void - writes the pedal on the screen based on the input x value from JS
+//               Only the pixels that differ between the previous and new pedal are sent to the LCD
 //  Arguments:
 //      pedalX - current JS value from ADC;
-//      pedalX_Prev - previous JS value from ADC (to erase)
+//      pedalX_Prev - previous JS value from ADC (to erase), PEDAL_NONE if no pedal is on screen
 //  Return value: none allowed
 /////////////////////////////////////////////////////
 void writePedal(int pedalX, int pedalX_prev);
 
 
+/////////////////////////////////////////////////////
+//  ballSpriteInit - Void - builds the ball sprite used by writeBall and moveBall, and sets
+//                   the LCD scroll area moveBalls drops the balls with
+//                   Must be called once (after lcdInit) before the ball is drawn
+//  Arguments: none
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void ballSpriteInit(void);
+
+
 /////////////////////////////////////////////////////
 //  writeBall - Void - writes the ball on the screen based on the input x and y values (or, erases)
 //  Arguments:
@@ -71,6 +117,33 @@ void writePedal(int pedalX, int pedalX_prev);
 void writeBall(int ballX, int ballY, int ballErase);
 
 
+/////////////////////////////////////////////////////
+//  moveBalls - Void - moves the balls on the screen from their old positions to their new ones
+//              Only the pixels that differ between the old and new balls are sent to the LCD
+//              A drop is done by scrolling the play field (everything above SCROLL_Y0, where
+//              the balls must be the only thing drawn) so only the rest of the move is sent
+//  Arguments:
+//      count - balls, at most BALLS_MAX
+//      ballX_Old, ballY_Old - center of each ball currently on screen
+//      ballX, ballY - new center of each ball
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void moveBalls(int count, const int *ballX_Old, const int *ballY_Old, const int *ballX, const int *ballY);
+
+
+/////////////////////////////////////////////////////
+//  moveBall - Void - moves a single ball on the screen from its old position to its new one,
+//             see moveBalls
+//  Arguments:
+//      ballX_Old - x value of center of ball currently on screen
+//      ballY_Old - y value of center of ball currently on screen
+//      ballX - new x value of center of ball
+//      ballY - new y value of center of ball
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void moveBall(int ballX_Old, int ballY_Old, int ballX, int ballY);
+
+
 /////////////////////////////////////////////////////
 //  msDelay -- Function to generate delay
 //  Arguments: ms - Number of milliseconds to delay
@@ -0,0 +1,878 @@
+// Filename: hal.c
+// Description: Hardware abstraction layer for the MSP432 LaunchPad with the Educational
+//              BoosterPack MKII. All of the register accesses of the project live here.
+// Author(s): Jimmy Bates (SPI and i2c code from Robert Trost's lcd.c and i2c.c)
+// Set: N/A
+// Date: Dec 2, 2020
+
+#include "msp.h"
+#include "hal.h"
+#include "adc.h"
+
+//  LCD pins
+#define LCD_SCK           BIT5  // P1.5 for UCB0 SCK connects to LCD SCK
+#define LCD_MOSI          BIT6  // P1.6 for UCB0 MOSI connects to LCD SDA
+#define LCD_RST           BIT7  // P5.7 connects to LCD RST pin
+#define LCD_CS            BIT0  // P5.0 connects to LCD CS pin
+#define LCD_DC            BIT7  // P3.7 connects to LCD DC pin
+
+//  Button pins
+#define S1                BIT1  // S1 button P5.1
+#define S2                BIT5  // S2 button P3.5
+
+//  i2c pins and timing
+#define SDA               BIT4  // P6.4 for UCB1 SDA
+#define SCL               BIT5  // P6.5 for UCB1 SCL
+#define RECOVERY_CLOCKS   9     // SCL pulses clocked out to free a slave holding SDA low
+#define RECOVERY_US       5     // microseconds per half SCL period during recovery (~100kHz)
+
+// Phase of the i2c transaction on the bus
+#define PHASE_IDLE        0     // no transaction on the bus
+#define PHASE_TX          1     // sending register address and data
+#define PHASE_RX          2     // receiving data after the repeated start
+#define PHASE_STOP        3     // waiting for the stop condition to complete
+
+#define I2C_INTERRUPTS    (UCTXIE0 | UCRXIE0 | UCSTPIE | UCNACKIE | UCALIE)
+
+// DMA transmit engine.  Channel 0 is triggered by UCB0TXIFG and feeds UCB0TXBUF
+#define DMA_CHANNEL         0
+#define DMA_CHANNEL_BIT     (1 << DMA_CHANNEL)
+#define DMA_SRC_EUSCIB0TX0  2       // channel 0 source 2 is eUSCI_B0 TX
+
+// DMA channel control word: fixed destination, byte source incrementing, basic mode
+#define DMA_CTL_DST_INC_NONE    (3UL << 30)
+#define DMA_CTL_SRC_INC_BYTE    (0UL << 26)
+#define DMA_CTL_SIZE_BYTE       (0UL << 24)
+#define DMA_CTL_N_MINUS_1(n)    ((unsigned long)((n) - 1) << 4)
+#define DMA_CTL_MODE_BASIC      1UL
+
+// One entry of the DMA channel control table
+typedef struct {
+    volatile const void *srcEnd;    // address of the last source byte
+    volatile void *dstEnd;          // address of the destination
+    volatile unsigned long control; // channel control word
+    unsigned long spare;
+} dmaDescriptor;
+
+// Control table must be aligned to its size (8 channels, primary and alternate)
+#if defined(__TI_COMPILER_VERSION__)
+#pragma DATA_ALIGN(dmaControlTable, 256)
+static dmaDescriptor dmaControlTable[16];
+#else
+static dmaDescriptor dmaControlTable[16] __attribute__((aligned(256)));
+#endif
+
+static void (*dmaHandler)(void);
+static void (*adcHandler)(const int *results);
+static void (*i2cHandler)(void);
+static void (*buttonHandler)(int button);
+static void (*tickHandler)(void);
+
+static int adcCount = 1;                // channels in the ADC sequence
+
+static i2cTransaction *i2cOnBus;        // transaction on the bus
+static int i2cPhase = PHASE_IDLE;
+static int i2cTxIndex;                  // next byte to send, -1 for the register address
+static int i2cRxIndex;                  // next byte to receive
+static int i2cError;                    // error the transaction on the bus ends with
+
+///////////////////////////////////////////////////////////////////////
+// i2cReset - Puts UCB1 through a software reset and configures it as
+//            i2c master again (also used after losing arbitration)
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void i2cReset(void);
+
+///////////////////////////////////////////////////////////////////////
+// i2cEnd - Takes the transaction off the bus
+// Arguments: status - I2C_OK or the error the transaction failed with
+// Return Value: status
+///////////////////////////////////////////////////////////////////////
+static int i2cEnd(int status);
+
+
+///////////////////////////////////////////////////////////////////////
+// halInit - Stops the watchdog and sets up the clocks of CLOCK_CONFIG,
+//           must be called first thing in main
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halInit(void)
+{
+    const clockConfig *clock = &clockConfigs[CLOCK_CONFIG];
+
+    WDT_A->CTL = WDT_A_CTL_PW | WDT_A_CTL_HOLD;     // stop watchdog timer
+
+    // core voltage and flash wait states go up before the clock does
+    while(PCM->CTL1 & PCM_CTL1_PMR_BUSY) { }
+    PCM->CTL0 = PCM_CTL0_KEY_VAL | (clock->vcore << PCM_CTL0_AMR_OFS);
+    while(PCM->CTL1 & PCM_CTL1_PMR_BUSY) { }
+
+    FLCTL->BANK0_RDCTL = (FLCTL->BANK0_RDCTL & ~FLCTL_BANK0_RDCTL_WAIT_MASK)
+                       | (clock->flashWaits << FLCTL_BANK0_RDCTL_WAIT_OFS);
+    FLCTL->BANK1_RDCTL = (FLCTL->BANK1_RDCTL & ~FLCTL_BANK1_RDCTL_WAIT_MASK)
+                       | (clock->flashWaits << FLCTL_BANK1_RDCTL_WAIT_OFS);
+
+    // DCO range, MCLK straight from the DCO, SMCLK divided from it
+    CS->KEY = CS_KEY_VAL;
+    CS->CTL0 = clock->dcoRange << CS_CTL0_DCORSEL_OFS;
+    CS->CTL1 = (CS->CTL1 & ~(CS_CTL1_SELM_MASK | CS_CTL1_SELS_MASK | CS_CTL1_DIVS_MASK))
+             | CS_CTL1_SELM__DCOCLK | CS_CTL1_SELS__DCOCLK | (clock->smclkDivs << CS_CTL1_DIVS_OFS);
+    CS->KEY = 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halEnableInterrupts - Enables interrupts globally
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halEnableInterrupts(void)
+{
+    __enable_irq();
+}
+
+///////////////////////////////////////////////////////////////////////
+// halIrqSave - Disables interrupts for a critical section
+// Arguments: none
+// Return Value: interrupt state to be passed to halIrqRestore
+///////////////////////////////////////////////////////////////////////
+unsigned long halIrqSave(void)
+{
+    unsigned long primask = __get_PRIMASK();
+
+    __disable_irq();
+    return primask;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halIrqRestore - Ends a critical section, interrupts are enabled again
+//                 only if they were enabled at the matching halIrqSave
+// Arguments: state - value returned by halIrqSave
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halIrqRestore(unsigned long state)
+{
+    __set_PRIMASK(state);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halDelayMs - Busy waits for at least a number of milliseconds
+// Arguments: ms - milliseconds to wait
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halDelayMs(unsigned int ms)
+{
+    while(ms-- > 0) {
+        __delay_cycles(HAL_MCLK_HZ / 1000);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// halDelayUs - Busy waits for at least a number of microseconds
+// Arguments: us - microseconds to wait
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halDelayUs(unsigned int us)
+{
+    // loop overhead makes this run long, which is fine for the i2c timings it is used for
+    while(us-- > 0) {
+        __delay_cycles(HAL_MCLK_HZ / 1000000);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// halCyclesInit - Starts the free running cycle counter (DWT CYCCNT)
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halCyclesInit(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;     // enable the DWT unit
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halCycles - Reads the cycle counter, which wraps every 2^32 counts
+// Arguments: none
+// Return Value: MCLK cycles since halCyclesInit
+///////////////////////////////////////////////////////////////////////
+unsigned long halCycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halTimerJitter - Reads the cycle counter for its timing jitter
+// Arguments: none
+// Return Value: MCLK cycles, wrapping every 2^32
+///////////////////////////////////////////////////////////////////////
+unsigned long halTimerJitter(void)
+{
+    // the probes start the counter, it is left alone if they did
+    if(!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halSpiInit - Sets up UCB0 as SPI master for the LCD, the CS, RST and
+//              DC pins, and the DMA channel feeding the SPI
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiInit(void)
+{
+    // enable pins for UCB0 SPI MOSI/SCK
+    P1->SEL1 &= ~(LCD_SCK | LCD_MOSI);
+    P1->SEL0 |= (LCD_SCK | LCD_MOSI);
+
+    // enable CS, RST and DC outputs
+    P5->DIR |= LCD_CS;      // LCD Chip Select P5.0 set to OUT
+    P5->DIR |= LCD_RST;     // LCD RST P5.7 set to OUT
+    P3->DIR |= LCD_DC;      // LCD Data/Command P3.7 set to OUT
+
+    // activate CS (check data sheet.  Is this active high or low?)
+    P5->OUT &= ~LCD_CS;
+
+    // ensure UCB0 SPI module in software reset
+    EUSCI_B0_SPI->CTLW0 |= EUSCI_B_CTLW0_SWRST;
+
+    // configure SPI as master, MSB first, SMCLK as clock source data, captured on first clock edge
+    EUSCI_B0_SPI->CTLW0 |= (EUSCI_B_CTLW0_MST | EUSCI_B_CTLW0_MSB | EUSCI_A_CTLW0_UCSSEL_2 | EUSCI_A_CTLW0_CKPH);
+
+    // configure SPI as low clock inactive state
+    EUSCI_B0_SPI->CTLW0  &= ~EUSCI_A_CTLW0_CKPL;
+
+    // bit clock divided from SMCLK
+    EUSCI_B0_SPI->BRW = clockConfigs[CLOCK_CONFIG].spiDivider;
+
+    // take UCB0 SPI module out of software reset
+    EUSCI_B0_SPI->CTLW0 &= ~EUSCI_B_CTLW0_SWRST;
+
+    // enable the DMA controller and point it at the control table
+    DMA_Control->CFG = DMA_CFG_MASTEN;
+    DMA_Control->CTLBASE = (unsigned long)dmaControlTable;
+
+    // channel 0 triggered by UCB0TXIFG, primary structure only, normal priority
+    DMA_Channel->CH_SRCCFG[DMA_CHANNEL] = DMA_SRC_EUSCIB0TX0;
+    DMA_Control->ALTCLR = DMA_CHANNEL_BIT;
+    DMA_Control->USEBURSTCLR = DMA_CHANNEL_BIT;
+    DMA_Control->REQMASKCLR = DMA_CHANNEL_BIT;
+
+    // completion of channel 0 raises DMA_INT1
+    DMA_Channel->INT0_CLRFLG = DMA_CHANNEL_BIT;
+    DMA_Channel->INT1_SRCCFG = DMA_INT1_SRCCFG_EN | DMA_CHANNEL;
+    NVIC_EnableIRQ(DMA_INT1_IRQn);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halLcdReset - Drives the LCD reset pin
+// Arguments: active - true to hold the LCD in reset, false to release it
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halLcdReset(int active)
+{
+    if(active) {
+        P5->OUT &= ~LCD_RST;
+    } else {
+        P5->OUT |= LCD_RST;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// halSpiWrite - Sends one byte to the LCD, waiting for the previous
+//               byte to be shifted out first
+// Arguments: byte - value to be sent
+//            isData - true if byte is data, false if byte is a command
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiWrite(unsigned char byte, int isData)
+{
+    // poll UCBUSY register bit to determine if finished transmitting previous byte
+    while(EUSCI_B0_SPI->STATW & EUSCI_B_STATW_SPI_BUSY) { }
+
+    // set data/command pin (p3.7) for data, clear it for a command
+    if(isData) {
+        P3->OUT |= LCD_DC;
+    } else {
+        P3->OUT &= ~LCD_DC;
+    }
+
+    // Transmit byte
+    EUSCI_B0_SPI->TXBUF = byte;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halSpiWriteRun - Sends bytes to the LCD back to back, setting the
+//                  data/command pin once for all of them. Returns once
+//                  the last byte is handed to the SPI.
+// Arguments: data - bytes to be sent
+//            length - number of bytes
+//            isData - true if bytes are data, false if they are commands
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiWriteRun(const unsigned char *data, int length, int isData)
+{
+    // data/command pin may only change once the previous byte has been shifted out
+    while(EUSCI_B0_SPI->STATW & EUSCI_B_STATW_SPI_BUSY) { }
+    if(isData) {
+        P3->OUT |= LCD_DC;
+    } else {
+        P3->OUT &= ~LCD_DC;
+    }
+
+    // TXBUF takes the next byte as soon as the one before starts shifting out
+    while(length-- > 0) {
+        while(!(EUSCI_B0_SPI->IFG & EUSCI_B_IFG_TXIFG)) { }
+        EUSCI_B0_SPI->TXBUF = *data++;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// halSpiDmaStart - Starts the DMA sending bytes to the LCD in the
+//                  background. The previous DMA must be done.
+// Arguments: data - bytes to be sent, must stay valid until done
+//            length - number of bytes (1 to HAL_DMA_MAX_LENGTH)
+//            isData - true if bytes are data, false if they are commands
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiDmaStart(const unsigned char *data, int length, int isData)
+{
+    // data/command pin may only change once the previous byte has been shifted out
+    while(EUSCI_B0_SPI->STATW & EUSCI_B_STATW_SPI_BUSY) { }
+    if(isData) {
+        P3->OUT |= LCD_DC;
+    } else {
+        P3->OUT &= ~LCD_DC;
+    }
+
+    dmaControlTable[DMA_CHANNEL].srcEnd = data + length - 1;
+    dmaControlTable[DMA_CHANNEL].dstEnd = &EUSCI_B0_SPI->TXBUF;
+    dmaControlTable[DMA_CHANNEL].control = DMA_CTL_DST_INC_NONE | DMA_CTL_SRC_INC_BYTE | DMA_CTL_SIZE_BYTE
+                                         | DMA_CTL_N_MINUS_1(length) | DMA_CTL_MODE_BASIC;
+
+    DMA_Control->ENASET = DMA_CHANNEL_BIT;
+
+    // TXIFG is already set while the SPI is idle, so kick off the first byte by software
+    if(EUSCI_B0_SPI->IFG & EUSCI_B_IFG_TXIFG) {
+        DMA_Channel->SW_CHTRIG = DMA_CHANNEL_BIT;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// halSpiDmaDone - Checks (and clears) the DMA completion flag
+// Arguments: none
+// Return Value: true once when the DMA started last has finished
+///////////////////////////////////////////////////////////////////////
+int halSpiDmaDone(void)
+{
+    if(DMA_Channel->INT0_SRCFLG & DMA_CHANNEL_BIT) {
+        DMA_Channel->INT0_CLRFLG = DMA_CHANNEL_BIT;
+        return 1;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halSpiDmaOnDone - Sets the function called from the DMA interrupt
+// Arguments: handler - function to call, or 0 for none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiDmaOnDone(void (*handler)(void))
+{
+    dmaHandler = handler;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halAdcPin - Switches the pin of an analog input to its analog function
+// Arguments: analogChannel - analog input A0 to A15
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void halAdcPin(int analogChannel)
+{
+    int bit;
+
+    if(analogChannel <= 5) {
+        bit = 1 << (5 - analogChannel);         // A0 to A5 are P5.5 down to P5.0
+        P5->SEL1 |= bit;
+        P5->SEL0 |= bit;
+    } else if(analogChannel <= 13) {
+        bit = 1 << (13 - analogChannel);        // A6 to A13 are P4.7 down to P4.0
+        P4->SEL1 |= bit;
+        P4->SEL0 |= bit;
+    } else if(analogChannel <= 15) {
+        bit = 1 << (15 - analogChannel);        // A14 and A15 are P6.1 and P6.0
+        P6->SEL1 |= bit;
+        P6->SEL0 |= bit;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// halAdcInit - Sets up ADC14 to convert a sequence of analog inputs in
+//              one burst started by software, and their pins as inputs
+// Arguments: analogChannels - the analog inputs, channel n into MEM[n]
+//            count - number of channels (1 to 8)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halAdcInit(const int *analogChannels, int count)
+{
+    int channel;    // index into the sequence
+
+    adcCount = count;
+
+    //Clear ADC Enable Conv bit
+    ADC14->CTL0 &= ~ADC14_CTL0_ENC;
+
+    //Sequence of channels once per start, MSC converts the rest without waiting for a trigger
+    ADC14->CTL0 = ADC14_CTL0_ON | ADC14_CTL0_SHP | ADC14_CTL0_MSC | ADC14_CTL0_CONSEQ_1 | ADC14_CTL0_SHS_0;
+
+    //Sequence starts at MEM[0], no interrupts until halAdcStartTimer
+    ADC14->CTL1 &= ~ADC14_CTL1_CSTARTADD_MASK;
+    ADC14->IER0 = 0;
+
+    //Select analog input for each of Mem[0] to Mem[count-1], end of sequence on the last
+    for(channel = 0; channel < count; channel++) {
+        halAdcPin(analogChannels[channel]);
+        ADC14->MCTL[channel] = analogChannels[channel];
+    }
+    ADC14->MCTL[count - 1] |= ADC14_MCTLN_EOS;
+
+    //Set ADC Enable Conv bit (enable conversions)
+    ADC14->CTL0 |= ADC14_CTL0_ENC;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halAdcConvert - Converts the sequence set by halAdcInit and waits
+// Arguments: results - filled with the result of every channel
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halAdcConvert(int *results)
+{
+    int channel;    // index into the sequence
+
+    //Start the conversion
+    ADC14->CTL0 |= ADC14_CTL0_SC;
+
+    //Wait for the last channel of the sequence to complete
+    while(!(ADC14->IFGR0 & (1 << (adcCount - 1)))) {
+    }
+
+    //Get the ADC results from Mem[0] onwards
+    for(channel = 0; channel < adcCount; channel++) {
+        results[channel] = ADC14->MEM[channel];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// halAdcStartTimer - Converts the sequence set by halAdcInit over and
+//                    over, each burst triggered by Timer_A1 (the ADC14
+//                    interrupt arms the next one)
+// Arguments: period - SMCLK cycles between bursts
+//            handler - called from the ADC interrupt with the results
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halAdcStartTimer(int period, void (*handler)(const int *results))
+{
+    adcHandler = handler;
+
+    //One sequence per Timer_A1 CCR1 edge (SHS 3). Repeat mode (CONSEQ_3) with MSC would only wait
+    //for the first edge and then convert back to back, so the sequence runs once and is re-armed
+    ADC14->CTL0 &= ~ADC14_CTL0_ENC;
+    ADC14->CTL0 = ADC14_CTL0_ON | ADC14_CTL0_SHP | ADC14_CTL0_MSC | ADC14_CTL0_CONSEQ_1 | ADC14_CTL0_SHS_3;
+
+    //Interrupt when the last channel of the burst holds a new result
+    ADC14->CLRIFGR0 = 1 << (adcCount - 1);
+    ADC14->IER0 = 1 << (adcCount - 1);
+    NVIC_EnableIRQ(ADC14_IRQn);
+
+    //Set ADC Enable Conv bit (enable conversions)
+    ADC14->CTL0 |= ADC14_CTL0_ENC;
+
+    //Timer_A1 in up mode, CCR1 output set/reset gives one rising edge per period
+    TIMER_A1->CCR[0] = period - 1;
+    TIMER_A1->CCR[1] = period / 2;
+    TIMER_A1->CCTL[1] = TIMER_A_CCTLN_OUTMOD_7;
+    TIMER_A1->CTL = TIMER_A_CTL_SSEL__SMCLK | TIMER_A_CTL_MC__UP | TIMER_A_CTL_CLR;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halI2cInit - Frees the i2c bus and sets up UCB1 as i2c master (~400kHz)
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halI2cInit(void)
+{
+    // a slave left mid transfer (e.g. by a reset) can hold SDA low, free the bus first
+    halI2cRecover();
+
+    // set divisor for ~400kHz i2c clock
+    EUSCI_B1->CTLW0 |= EUSCI_B_CTLW0_SWRST;
+    EUSCI_B1->BRW = clockConfigs[CLOCK_CONFIG].i2cDivider;
+
+    // set in master I2C synchronous mode with SMCLK source
+    i2cReset();
+
+    // transactions are moved on by the UCB1 interrupt
+    NVIC_EnableIRQ(EUSCIB1_IRQn);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halI2cRecover - Gives up any transaction on the bus and frees the bus
+//                 from a slave holding SDA low by clocking out SCL pulses
+//                 on the pins as GPIO, then sending a stop
+// Arguments: none
+// Return Value: I2C_OK if SDA was released, I2C_ERR_BUS_STUCK if not
+///////////////////////////////////////////////////////////////////////
+int halI2cRecover(void)
+{
+    int clock;      // SCL pulses sent
+    int status;
+
+    // ensure in software reset while the pins are taken over
+    EUSCI_B1->CTLW0 |= EUSCI_B_CTLW0_SWRST;
+    i2cPhase = PHASE_IDLE;
+
+    // pins 6.4 and 6.5 as GPIO, SCL driven high, SDA released (pulled up externally)
+    P6->OUT |= SCL;
+    P6->DIR |= SCL;
+    P6->DIR &= ~SDA;
+    P6->SEL0 &= ~(SDA | SCL);
+    P6->SEL1 &= ~(SDA | SCL);
+    halDelayUs(RECOVERY_US);
+
+    // clock SCL until the slave lets go of SDA
+    for(clock = 0; clock < RECOVERY_CLOCKS && !(P6->IN & SDA); clock++) {
+        P6->OUT &= ~SCL;
+        halDelayUs(RECOVERY_US);
+        P6->OUT |= SCL;
+        halDelayUs(RECOVERY_US);
+    }
+
+    status = (P6->IN & SDA) ? I2C_OK : I2C_ERR_BUS_STUCK;
+
+    // stop condition: SDA low to high while SCL is high
+    P6->OUT &= ~(SCL | SDA);
+    P6->DIR |= SDA;
+    halDelayUs(RECOVERY_US);
+    P6->OUT |= SCL;
+    halDelayUs(RECOVERY_US);
+    P6->DIR &= ~SDA;
+    halDelayUs(RECOVERY_US);
+
+    // configure pins 6.4 and 6.5 for SDA and SCL for I2C
+    P6->DIR &= ~SCL;
+    P6->SEL0 |= (SDA | SCL);
+    P6->SEL1 &= ~(SDA | SCL);
+
+    i2cReset();
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////
+// i2cReset - Puts UCB1 through a software reset and configures it as
+//            i2c master again (also used after losing arbitration)
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void i2cReset(void)
+{
+    // ensure in software reset (EUSCI_B_CTLW0_SWRST==1)
+    EUSCI_B1->CTLW0 |= EUSCI_B_CTLW0_SWRST;
+
+    // set in master I2C synchronous mode with SMCLK source
+    EUSCI_B1->CTLW0 |= (EUSCI_B_CTLW0_MST | EUSCI_B_CTLW0_MODE_3 | EUSCI_B_CTLW0_SYNC | EUSCI_B_CTLW0_UCSSEL_2);
+
+    // remove software reset (clears all flags and interrupt enables)
+    EUSCI_B1->CTLW0 &= ~EUSCI_B_CTLW0_SWRST;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halI2cStart - Puts a transaction on the bus, the bus must be free
+// Arguments: transaction - transaction to carry out
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halI2cStart(i2cTransaction *transaction)
+{
+    i2cOnBus = transaction;
+
+    // set slave address
+    EUSCI_B1->I2CSA = transaction->slaveAddr;
+
+    i2cTxIndex = -1;
+    i2cRxIndex = 0;
+    i2cError = I2C_OK;
+    i2cPhase = PHASE_TX;
+
+    // interrupt on space in TX buf, receive data, stop complete, NACK and arbitration lost
+    EUSCI_B1->IFG &= ~(UCTXIFG | UCRXIFG | UCSTPIFG | UCNACKIFG | UCALIFG);
+    EUSCI_B1->IE |= I2C_INTERRUPTS;
+
+    // send start condition in transmit mode
+    EUSCI_B1->CTLW0 |= UCTR | UCTXSTT;
+}
+
+///////////////////////////////////////////////////////////////////////
+// i2cEnd - Takes the transaction off the bus
+// Arguments: status - I2C_OK or the error the transaction failed with
+// Return Value: status
+///////////////////////////////////////////////////////////////////////
+static int i2cEnd(int status)
+{
+    EUSCI_B1->IE &= ~I2C_INTERRUPTS;
+    i2cPhase = PHASE_IDLE;
+    return status;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halI2cService - Moves the transaction on the bus on for every pending
+//                 flag. Must be called with interrupts disabled.
+// Arguments: none
+// Return Value: I2C_PENDING while the transaction is on the bus (or
+//               there is none), then once I2C_OK or its I2C_ERR_ code
+///////////////////////////////////////////////////////////////////////
+int halI2cService(void)
+{
+    i2cTransaction *transaction = i2cOnBus;
+    int flags;
+
+    if(i2cPhase == PHASE_IDLE) {
+        return I2C_PENDING;
+    }
+
+    flags = EUSCI_B1->IFG & EUSCI_B1->IE;
+
+    // lost arbitration to another master: UCB1 has dropped to slave mode, so reset it
+    if(flags & UCALIFG) {
+        i2cReset();
+        return i2cEnd(I2C_ERR_ARBITRATION);
+    }
+
+    // slave did not acknowledge its address or a byte: send stop and fail once it completes
+    if(flags & UCNACKIFG) {
+        EUSCI_B1->IFG &= ~UCNACKIFG;
+        EUSCI_B1->IE &= ~(UCTXIE0 | UCRXIE0);
+        EUSCI_B1->CTLW0 |= UCTXSTP;
+        i2cPhase = PHASE_STOP;
+        i2cError = I2C_ERR_NACK;
+    }
+
+    // space in TX buf: send register address, then data, then restart or stop
+    if(i2cPhase == PHASE_TX && (flags & UCTXIFG)) {
+        if(i2cTxIndex < 0) {
+            EUSCI_B1->TXBUF = transaction->regAddr;
+            i2cTxIndex = 0;
+        } else if(i2cTxIndex < transaction->txLength) {
+            EUSCI_B1->TXBUF = transaction->txData[i2cTxIndex++];
+        } else if(transaction->rxLength > 0) {
+            // set in receive mode and send repeated start condition
+            EUSCI_B1->IE &= ~UCTXIE0;
+            EUSCI_B1->CTLW0 = (EUSCI_B1->CTLW0 & ~UCTR) | UCTXSTT;
+            i2cPhase = PHASE_RX;
+        } else {
+            // send stop condition
+            EUSCI_B1->IE &= ~UCTXIE0;
+            EUSCI_B1->CTLW0 |= UCTXSTP;
+            i2cPhase = PHASE_STOP;
+        }
+    }
+
+    // receive data: stop is queued while the second to last byte is read. A single byte read
+    // queues it with its only byte rather than waiting in here for the start to go out, so the
+    // slave clocks out one more byte, which is NACKed and left in RXBUF
+    if(i2cPhase == PHASE_RX && (flags & UCRXIFG)) {
+        if(transaction->rxLength - i2cRxIndex == 2 || transaction->rxLength == 1) {
+            EUSCI_B1->CTLW0 |= UCTXSTP;
+        }
+        transaction->rxData[i2cRxIndex++] = EUSCI_B1->RXBUF;
+        if(i2cRxIndex >= transaction->rxLength) {
+            EUSCI_B1->IE &= ~UCRXIE0;
+            i2cPhase = PHASE_STOP;
+        }
+    }
+
+    // stop complete, transaction is finished
+    if(i2cPhase == PHASE_STOP && (EUSCI_B1->IFG & UCSTPIFG)) {
+        EUSCI_B1->IFG &= ~UCSTPIFG;
+        return i2cEnd(i2cError);
+    }
+
+    return I2C_PENDING;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halI2cOnEvent - Sets the function called from the UCB1 interrupt
+// Arguments: handler - function to call, or 0 for none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halI2cOnEvent(void (*handler)(void))
+{
+    i2cHandler = handler;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halButtonsInit - Sets up S1 and S2 as inputs interrupting on a press
+// Arguments: handler - called from the port interrupts with
+//                      HAL_BUTTON_S1 or HAL_BUTTON_S2
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halButtonsInit(void (*handler)(int button))
+{
+    buttonHandler = handler;
+
+    // Setup S1 Button P5.1 (Active low, normally closed), interrupt on falling edge
+    P5->DIR &= ~S1;
+    P5->IES |= S1;
+    P5->IFG &= ~S1;
+    P5->IE |= S1;
+
+    // Setup S2 Button P3.5 (Active low, normally closed), interrupt on falling edge
+    P3->DIR &= ~S2;
+    P3->IES |= S2;
+    P3->IFG &= ~S2;
+    P3->IE |= S2;
+
+    NVIC_EnableIRQ(PORT5_IRQn);
+    NVIC_EnableIRQ(PORT3_IRQn);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halButtonDown - Reads a button
+// Arguments: button - HAL_BUTTON_S1 or HAL_BUTTON_S2
+// Return Value: true if the button is pressed
+///////////////////////////////////////////////////////////////////////
+int halButtonDown(int button)
+{
+    if(button == HAL_BUTTON_S1) {
+        return !(P5->IN & S1);
+    }
+    return !(P3->IN & S2);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halTickInit - Starts Timer_A0 interrupting once every period
+// Arguments: period - timer counts (HAL_TICK_HZ) per tick
+//            handler - called from the Timer_A0 interrupt
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halTickInit(int period, void (*handler)(void))
+{
+    tickHandler = handler;
+
+    // SMCLK divided down to HAL_TICK_HZ, up mode
+    TIMER_A0->CTL = TIMER_A_CTL_SSEL__SMCLK | (clockConfigs[CLOCK_CONFIG].tickId << TIMER_A_CTL_ID_OFS)
+                  | TIMER_A_CTL_MC__UP | TIMER_A_CTL_IE;
+    TIMER_A0->EX0 = clockConfigs[CLOCK_CONFIG].tickIdex << TIMER_A_EX0_IDEX_OFS;
+    TIMER_A0->CCR[0] = period - 1;
+
+    NVIC_EnableIRQ(TA0_N_IRQn);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halFrameDone - Nothing to do on the board
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halFrameDone(void)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// DMA_INT1 ISR - Passes DMA completion on to lcd.c
+// Arguments: None allowed
+// Return values: None
+///////////////////////////////////////////////////////////////////////
+void DMA_INT1_IRQHandler(void)
+{
+    if(dmaHandler) {
+        dmaHandler();
+    } else {
+        halSpiDmaDone();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// ADC14 ISR - Passes a continuous mode burst on to adc.c
+// Arguments: None allowed
+// Return values: None
+///////////////////////////////////////////////////////////////////////
+void ADC14_IRQHandler(void)
+{
+    int results[ADC_MAX_CHANNELS];  // one burst, MEM[0] onwards
+    int channel;
+
+    //Reading MEM[n] clears its interrupt flag
+    for(channel = 0; channel < adcCount; channel++) {
+        results[channel] = ADC14->MEM[channel];
+    }
+
+    //Arm the sequence again for the next Timer_A1 edge
+    ADC14->CTL0 &= ~ADC14_CTL0_ENC;
+    ADC14->CTL0 |= ADC14_CTL0_ENC;
+
+    if(adcHandler) {
+        adcHandler(results);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// UCB1 ISR - Passes i2c events on to i2c.c
+// Arguments: None allowed
+// Return values: None
+///////////////////////////////////////////////////////////////////////
+void EUSCIB1_IRQHandler(void)
+{
+    if(i2cHandler) {
+        i2cHandler();
+    } else {
+        EUSCI_B1->IE &= ~I2C_INTERRUPTS;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// Timer_A0 TAIFG ISR - Passes the tick on to main.c
+// Arguments: None allowed
+// Return values: None
+///////////////////////////////////////////////////////////////////////
+void TA0_N_IRQHandler(void)
+{
+    //clear Timer flag
+    TIMER_A0->CTL &= ~TIMER_A_CTL_IFG;
+
+    if(tickHandler) {
+        tickHandler();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// PORT5 ISR - S1 button press
+// Arguments: None allowed
+// Return values: None
+///////////////////////////////////////////////////////////////////////
+void PORT5_IRQHandler(void)
+{
+    //Clear S1 Button IFG (P5.1)
+    P5->IFG &= ~S1;
+
+    if(buttonHandler) {
+        buttonHandler(HAL_BUTTON_S1);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// PORT3 ISR - S2 button press
+// Arguments: None allowed
+// Return values: None
+///////////////////////////////////////////////////////////////////////
+void PORT3_IRQHandler(void)
+{
+    //Clear S2 Button IFG (P3.5)
+    P3->IFG &= ~S2;
+
+    if(buttonHandler) {
+        buttonHandler(HAL_BUTTON_S2);
+    }
+}
@@ -0,0 +1,248 @@
+// Filename: hal.h
+// Description: Hardware abstraction layer. These are the only functions that touch the
+//              MSP432 registers: hal.c implements them for the board, sim/halsim.c for
+//              the Linux simulator
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#include "i2c.h"
+#include "clocks.h"
+
+#define HAL_MCLK_HZ         CLOCK_MCLK_HZ   // CPU clock, set by halInit
+#define HAL_SMCLK_HZ        CLOCK_SMCLK_HZ  // peripheral clock the SPI, i2c and timers run from
+#define HAL_TICK_HZ         CLOCK_TICK_HZ   // count rate of the tick timer
+#define HAL_DMA_MAX_LENGTH  1024        // most bytes sent by one halSpiDmaStart
+
+// Buttons on the BoosterPack/LaunchPad passed to the button handler
+#define HAL_BUTTON_S1       0           // S1 (P5.1)
+#define HAL_BUTTON_S2       1           // S2 (P3.5)
+
+///////////////////////////////////////////////////////////////////////
+// halInit - Stops the watchdog and sets up the clocks of CLOCK_CONFIG,
+//           must be called first thing in main
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halInit(void);
+
+///////////////////////////////////////////////////////////////////////
+// halEnableInterrupts - Enables interrupts globally
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halEnableInterrupts(void);
+
+///////////////////////////////////////////////////////////////////////
+// halIrqSave - Disables interrupts for a critical section
+// Arguments: none
+// Return Value: interrupt state to be passed to halIrqRestore
+///////////////////////////////////////////////////////////////////////
+unsigned long halIrqSave(void);
+
+///////////////////////////////////////////////////////////////////////
+// halIrqRestore - Ends a critical section, interrupts are enabled again
+//                 only if they were enabled at the matching halIrqSave
+// Arguments: state - value returned by halIrqSave
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halIrqRestore(unsigned long state);
+
+///////////////////////////////////////////////////////////////////////
+// halDelayMs - Busy waits for at least a number of milliseconds
+// Arguments: ms - milliseconds to wait
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halDelayMs(unsigned int ms);
+
+///////////////////////////////////////////////////////////////////////
+// halDelayUs - Busy waits for at least a number of microseconds
+// Arguments: us - microseconds to wait
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halDelayUs(unsigned int us);
+
+///////////////////////////////////////////////////////////////////////
+// halCyclesInit - Starts the free running cycle counter (DWT CYCCNT)
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halCyclesInit(void);
+
+///////////////////////////////////////////////////////////////////////
+// halCycles - Reads the cycle counter, which wraps every 2^32 counts.
+//             Counts MCLK cycles on the board, nanoseconds of the host's
+//             monotonic clock in the simulator.
+// Arguments: none
+// Return Value: counter value
+///////////////////////////////////////////////////////////////////////
+unsigned long halCycles(void);
+
+///////////////////////////////////////////////////////////////////////
+// halTimerJitter - Reads a free running counter for its timing jitter,
+//                  to be mixed into a seed: how many counts an i2c read
+//                  or an ADC conversion takes varies a little every run.
+//                  The MCLK cycle counter on the board (started if it is
+//                  not running), virtual ns in the simulator.
+// Arguments: none
+// Return Value: counter value, wrapping every 2^32
+///////////////////////////////////////////////////////////////////////
+unsigned long halTimerJitter(void);
+
+///////////////////////////////////////////////////////////////////////
+// halSpiInit - Sets up UCB0 as SPI master for the LCD, the CS, RST and
+//              DC pins, and the DMA channel feeding the SPI
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiInit(void);
+
+///////////////////////////////////////////////////////////////////////
+// halLcdReset - Drives the LCD reset pin
+// Arguments: active - true to hold the LCD in reset, false to release it
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halLcdReset(int active);
+
+///////////////////////////////////////////////////////////////////////
+// halSpiWrite - Sends one byte to the LCD, waiting for the previous
+//               byte to be shifted out first
+// Arguments: byte - value to be sent
+//            isData - true if byte is data, false if byte is a command
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiWrite(unsigned char byte, int isData);
+
+///////////////////////////////////////////////////////////////////////
+// halSpiWriteRun - Sends bytes to the LCD back to back, setting the
+//                  data/command pin once for all of them. Returns once
+//                  the last byte is handed to the SPI.
+// Arguments: data - bytes to be sent
+//            length - number of bytes
+//            isData - true if bytes are data, false if they are commands
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiWriteRun(const unsigned char *data, int length, int isData);
+
+///////////////////////////////////////////////////////////////////////
+// halSpiDmaStart - Starts the DMA sending bytes to the LCD in the
+//                  background. The previous DMA must be done.
+// Arguments: data - bytes to be sent, must stay valid until done
+//            length - number of bytes (1 to HAL_DMA_MAX_LENGTH)
+//            isData - true if bytes are data, false if they are commands
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiDmaStart(const unsigned char *data, int length, int isData);
+
+///////////////////////////////////////////////////////////////////////
+// halSpiDmaDone - Checks (and clears) the DMA completion flag
+// Arguments: none
+// Return Value: true once when the DMA started last has finished
+///////////////////////////////////////////////////////////////////////
+int halSpiDmaDone(void);
+
+///////////////////////////////////////////////////////////////////////
+// halSpiDmaOnDone - Sets the function called from the DMA interrupt
+// Arguments: handler - function to call, or 0 for none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiDmaOnDone(void (*handler)(void));
+
+///////////////////////////////////////////////////////////////////////
+// halAdcInit - Sets up ADC14 to convert a sequence of analog inputs in
+//              one burst started by software, and their pins as inputs
+// Arguments: analogChannels - the analog inputs, channel n into MEM[n]
+//            count - number of channels (1 to 8)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halAdcInit(const int *analogChannels, int count);
+
+///////////////////////////////////////////////////////////////////////
+// halAdcConvert - Converts the sequence set by halAdcInit and waits
+// Arguments: results - filled with the result of every channel
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halAdcConvert(int *results);
+
+///////////////////////////////////////////////////////////////////////
+// halAdcStartTimer - Converts the sequence set by halAdcInit over and
+//                    over, each burst triggered by Timer_A1
+// Arguments: period - SMCLK cycles between bursts
+//            handler - called from the ADC interrupt with the results
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halAdcStartTimer(int period, void (*handler)(const int *results));
+
+///////////////////////////////////////////////////////////////////////
+// halI2cInit - Frees the i2c bus and sets up UCB1 as i2c master (~400kHz)
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halI2cInit(void);
+
+///////////////////////////////////////////////////////////////////////
+// halI2cRecover - Gives up any transaction on the bus and frees the bus
+//                 from a slave holding SDA low
+// Arguments: none
+// Return Value: I2C_OK if SDA was released, I2C_ERR_BUS_STUCK if not
+///////////////////////////////////////////////////////////////////////
+int halI2cRecover(void);
+
+///////////////////////////////////////////////////////////////////////
+// halI2cStart - Puts a transaction on the bus, the bus must be free
+// Arguments: transaction - transaction to carry out
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halI2cStart(i2cTransaction *transaction);
+
+///////////////////////////////////////////////////////////////////////
+// halI2cService - Moves the transaction on the bus on. Must be called
+//                 with interrupts disabled.
+// Arguments: none
+// Return Value: I2C_PENDING while the transaction is on the bus (or
+//               there is none), then once I2C_OK or its I2C_ERR_ code
+///////////////////////////////////////////////////////////////////////
+int halI2cService(void);
+
+///////////////////////////////////////////////////////////////////////
+// halI2cOnEvent - Sets the function called from the UCB1 interrupt
+// Arguments: handler - function to call, or 0 for none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halI2cOnEvent(void (*handler)(void));
+
+///////////////////////////////////////////////////////////////////////
+// halButtonsInit - Sets up S1 and S2 as inputs interrupting on a press
+// Arguments: handler - called from the port interrupts with
+//                      HAL_BUTTON_S1 or HAL_BUTTON_S2
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halButtonsInit(void (*handler)(int button));
+
+///////////////////////////////////////////////////////////////////////
+// halButtonDown - Reads a button
+// Arguments: button - HAL_BUTTON_S1 or HAL_BUTTON_S2
+// Return Value: true if the button is pressed
+///////////////////////////////////////////////////////////////////////
+int halButtonDown(int button);
+
+///////////////////////////////////////////////////////////////////////
+// halTickInit - Starts Timer_A0 interrupting once every period
+// Arguments: period - timer counts (HAL_TICK_HZ) per tick
+//            handler - called from the Timer_A0 interrupt
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halTickInit(int period, void (*handler)(void));
+
+///////////////////////////////////////////////////////////////////////
+// halFrameDone - Called once a frame is on the screen. Nothing on the
+//                board, the simulator hashes the screen of replays.
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halFrameDone(void);
+
+#endif /* HAL_H_ */
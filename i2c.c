@@ -4,37 +4,55 @@
 // Set: N/A
 // Date: Mar 1, 2017 (created)
 
-#include "msp.h"
 #include "i2c.h"
-
-#define SDA             BIT4        // Pin for SDA for I2C
-#define SCL             BIT5        // Pin for SCL for I2C
-#define CLOCK_DIVISOR   8           // set clock to ~400kHz (should be slightly less than 400kHz)
+#include "hal.h"
 
 #define BITS_PER_BYTE   8           // 8 bits per tx/rx byte
 #define LSB_MASK        0xFF        // mask for least significant byte
 
+#define TIMEOUT_POLLS   500         // polls of a transaction before it is given up (~5ms)
+#define POLL_US         10          // microseconds between polls
+
+static i2cTransaction *i2cQueue[I2C_QUEUE_SIZE];    // ring of transactions, i2cHead is on the bus
+static volatile int i2cHead, i2cCount;
+
 ///////////////////////////////////////////////////////////////////////
-// i2cInit - Initializes the UCB1 i2c interface
+// i2cService - Moves the transaction on the bus on. Called from the
+//              UCB1 ISR or by polling.
 // Arguments: none
 // Return Value: none
 ///////////////////////////////////////////////////////////////////////
-void i2cInit(void) {
-    // configure pins 6.4 and 6.5 for SDA and SCL for I2C
-    P6->SEL0 |= (SDA | SCL);
-    P6->SEL1 &= ~(SDA | SCL);
+static void i2cService(void);
 
-    // ensure in software reset (EUSCI_B_CTLW0_SWRST==1)
-    EUSCI_B1->CTLW0 |= EUSCI_B_CTLW0_SWRST;
+///////////////////////////////////////////////////////////////////////
+// i2cFinish - Completes the transaction at the head of the queue and
+//             starts the next one
+// Arguments: status - I2C_OK or the error the transaction failed with
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void i2cFinish(int status);
 
-    // set in master I2C synchronous mode with SMCLK source
-    EUSCI_B1->CTLW0 |= (EUSCI_B_CTLW0_MST | EUSCI_B_CTLW0_MODE_3 | EUSCI_B_CTLW0_SYNC | EUSCI_B_CTLW0_UCSSEL_2);
+///////////////////////////////////////////////////////////////////////
+// i2cInit - Initializes the UCB1 i2c interface
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void i2cInit(void) {
+    // free the bus, then master mode ~400kHz
+    halI2cInit();
 
-    // set divisor for ~400kHz i2c clock
-    EUSCI_B1->BRW |= CLOCK_DIVISOR;
+    // transactions are moved on by the UCB1 interrupt
+    halI2cOnEvent(i2cService);
+}
 
-    // remove software reset
-    EUSCI_B1->CTLW0 &= ~EUSCI_B_CTLW0_SWRST;
+///////////////////////////////////////////////////////////////////////
+// i2cRecover - Frees the bus from a slave holding SDA low by clocking
+//              out SCL pulses on the pins as GPIO, then sending a stop
+// Arguments: none
+// Return Value: I2C_OK if SDA was released, I2C_ERR_BUS_STUCK if not
+///////////////////////////////////////////////////////////////////////
+int i2cRecover(void) {
+    return halI2cRecover();
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -42,45 +60,28 @@ void i2cInit(void) {
 // Arguments: slaveAddr - slave address of the device to receive the word
 //            regAddr - 8-bit register address to which the data is sent
 //            data - 16-bit data to be sent to slave device
-// Return Value: none
+// Return Value: I2C_OK or an I2C_ERR_ error code
 ///////////////////////////////////////////////////////////////////////
-void i2cWrite(char slaveAddr, char regAddr, int data) {
-
-    // wait until i2c completed any previous operations
-    while (EUSCI_B1->STATW & UCBBUSY);
-
-    // set slave address
-    EUSCI_B1->I2CSA = slaveAddr;
-
-    // send start condition in transmit mode
-    EUSCI_B1->CTLW0 |= UCTXSTT | UCTR;
-
-    // wait for space in TX buf
-    while ((EUSCI_B1->IFG & UCTXIFG) == 0) ;
-
-    // send register address
-    EUSCI_B1->TXBUF = regAddr;
-
-    // wait for space in TX buf
-    while ((EUSCI_B1->IFG & UCTXIFG) == 0) ;
-
-    // send MSB
-    EUSCI_B1->TXBUF = data >> BITS_PER_BYTE;
-
-    // wait for space in TX buf
-    while ((EUSCI_B1->IFG & UCTXIFG) == 0) ;
-
-    // send LSB
-    EUSCI_B1->TXBUF = data & LSB_MASK;
-
-    // wait for space in TX buf
-    while ((EUSCI_B1->IFG & UCTXIFG) == 0) ;
-
-    // send stop condition
-    EUSCI_B1->CTLW0 |= UCTXSTP;
-
-    // wait for stop to complete
-    while (EUSCI_B1->CTLW0 & UCTXSTP);
+int i2cWrite(char slaveAddr, char regAddr, int data) {
+    unsigned char bytes[2];     // data to send, MSB first
+    i2cTransaction write;
+
+    bytes[0] = data >> BITS_PER_BYTE;
+    bytes[1] = data & LSB_MASK;
+
+    write.slaveAddr = slaveAddr;
+    write.regAddr = regAddr;
+    write.txData = bytes;
+    write.txLength = 2;
+    write.rxData = 0;
+    write.rxLength = 0;
+    write.callback = 0;
+
+    // wait for space in the queue, then for the write to complete
+    while (i2cSubmit(&write) == I2C_ERR_QUEUE_FULL) {
+        i2cWait(i2cQueue[i2cHead]);
+    }
+    return i2cWait(&write);
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -89,57 +90,158 @@ void i2cWrite(char slaveAddr, char regAddr, int data) {
 //           of the register to be read from the slave device
 // Arguments: slaveAddr - slave address of the device to receive the word
 //            regAddr - 8-bit register address from which the data is read
-// Return Value:  16-bit data received from slave device
+//            data - set to the 16-bit data received from slave device
+// Return Value: I2C_OK or an I2C_ERR_ error code (data is left alone)
 ///////////////////////////////////////////////////////////////////////
-int i2cRead(char slaveAddr, char regAddr) {
-    int readData; // data read from i2C
-
-    // ensure i2c completed any previous operations
-    while (EUSCI_B1->STATW & UCBBUSY);
+int i2cRead(char slaveAddr, char regAddr, int *data) {
+    unsigned char bytes[2];     // data read, MSB first
+    int status = i2cReadBurst(slaveAddr, regAddr, bytes, 2);
 
-    // set slave address
-    EUSCI_B1->I2CSA = slaveAddr;
-
-    // send start condition in transmit mode
-    EUSCI_B1->CTLW0 |= UCTR | UCTXSTT;
+    // return read data
+    if (status == I2C_OK) {
+        *data = (bytes[0] << BITS_PER_BYTE) | bytes[1];
+    }
+    return status;
+}
 
-    // wait for space in TX buf
-    while ((EUSCI_B1->IFG & UCTXIFG) == 0) ;
+///////////////////////////////////////////////////////////////////////
+// i2cReadBurst - Receives several bytes from consecutive registers of a
+//                slave on the i2c bus
+// Arguments: slaveAddr - slave address of the device to receive from
+//            regAddr - 8-bit register address of the first byte read
+//            data - filled with the bytes read
+//            length - number of bytes to read
+// Return Value: I2C_OK or an I2C_ERR_ error code
+///////////////////////////////////////////////////////////////////////
+int i2cReadBurst(char slaveAddr, char regAddr, unsigned char *data, int length) {
+    i2cTransaction read;
+
+    read.slaveAddr = slaveAddr;
+    read.regAddr = regAddr;
+    read.txData = 0;
+    read.txLength = 0;
+    read.rxData = data;
+    read.rxLength = length;
+    read.callback = 0;
+
+    // wait for space in the queue, then for the read to complete
+    while (i2cSubmit(&read) == I2C_ERR_QUEUE_FULL) {
+        i2cWait(i2cQueue[i2cHead]);
+    }
+    return i2cWait(&read);
+}
 
-    // send register address
-    EUSCI_B1->TXBUF = regAddr;
+///////////////////////////////////////////////////////////////////////
+// i2cSubmit - Queues a transaction to be carried out in the background
+//             by the UCB1 interrupt. Returns without waiting for it.
+// Arguments: transaction - transaction to carry out, status is set to
+//                          I2C_PENDING
+// Return Value: I2C_OK if queued, I2C_ERR_QUEUE_FULL if not
+///////////////////////////////////////////////////////////////////////
+int i2cSubmit(i2cTransaction *transaction) {
+    unsigned long state = halIrqSave();
 
-    // wait for space in TX buf
-    while ((EUSCI_B1->IFG & UCTXIFG) == 0) ;
+    if (i2cCount >= I2C_QUEUE_SIZE) {
+        halIrqRestore(state);
+        return I2C_ERR_QUEUE_FULL;
+    }
 
-    // send stop condition
-    EUSCI_B1->CTLW0 |= UCTXSTP;
+    transaction->status = I2C_PENDING;
+    i2cQueue[(i2cHead + i2cCount) % I2C_QUEUE_SIZE] = transaction;
 
-    // wait for stop to complete
-    while (EUSCI_B1->CTLW0 & UCTXSTP);
+    // put it straight on the bus if the bus is free
+    if (i2cCount++ == 0) {
+        halI2cStart(transaction);
+    }
 
-    // set in receive mode and send start condition
-    EUSCI_B1->CTLW0 = (EUSCI_B1->CTLW0 & ~UCTR) | UCTXSTT;
+    halIrqRestore(state);
+    return I2C_OK;
+}
 
-    // wait for receive data
-    while ((EUSCI_B1->IFG & UCRXIFG) == 0) ;
+///////////////////////////////////////////////////////////////////////
+// i2cPoll - Gets the status of a submitted transaction. Moves the bus
+//           on itself if the UCB1 interrupt cannot run, so it is safe
+//           to call with interrupts disabled.
+// Arguments: transaction - submitted transaction
+// Return Value: status of the transaction
+///////////////////////////////////////////////////////////////////////
+int i2cPoll(i2cTransaction *transaction) {
+    i2cService();
+    return transaction->status;
+}
 
-    // get MSB
-    readData = EUSCI_B1->RXBUF;
-    readData = readData << BITS_PER_BYTE;
+///////////////////////////////////////////////////////////////////////
+// i2cWait - Waits for a submitted transaction to complete. If the
+//           transaction on the bus makes no progress for ~5ms it is
+//           given up with I2C_ERR_TIMEOUT and the bus is recovered.
+// Arguments: transaction - submitted transaction
+// Return Value: status of the transaction
+///////////////////////////////////////////////////////////////////////
+int i2cWait(i2cTransaction *transaction) {
+    unsigned long state;
+    i2cTransaction *onBus;  // transaction on the bus when the wait started
+    int polls;              // polls while the same transaction is on the bus
+
+    while (transaction->status == I2C_PENDING) {
+        onBus = i2cQueue[i2cHead];
+
+        for (polls = 0; polls < TIMEOUT_POLLS && onBus->status == I2C_PENDING; polls++) {
+            if (i2cPoll(transaction) != I2C_PENDING) {
+                return transaction->status;
+            }
+            halDelayUs(POLL_US);
+        }
+
+        // transaction on the bus is stuck: give it up, free the bus and move on
+        state = halIrqSave();
+        if (i2cCount && i2cQueue[i2cHead] == onBus && onBus->status == I2C_PENDING) {
+            halI2cRecover();
+            i2cFinish(I2C_ERR_TIMEOUT);
+        }
+        halIrqRestore(state);
+    }
+
+    return transaction->status;
+}
 
-    // send stop condition
-    EUSCI_B1->CTLW0 |= UCTXSTP;
+///////////////////////////////////////////////////////////////////////
+// i2cFinish - Completes the transaction at the head of the queue and
+//             starts the next one
+// Arguments: status - I2C_OK or the error the transaction failed with
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void i2cFinish(int status) {
+    i2cTransaction *transaction = i2cQueue[i2cHead];
 
-    // wait for receive data
-    while ((EUSCI_B1->IFG & UCRXIFG) == 0) ;
+    i2cHead = (i2cHead + 1) % I2C_QUEUE_SIZE;
+    i2cCount--;
 
-    // get LSB
-    readData |= EUSCI_B1->RXBUF;
+    transaction->status = status;
+    if (transaction->callback) {
+        transaction->callback(transaction);
+    }
 
-    // wait for stop to complete
-    while (EUSCI_B1->CTLW0 & UCTXSTP);
+    if (i2cCount) {
+        halI2cStart(i2cQueue[i2cHead]);
+    }
+}
 
-    // return read data
-    return readData;
+///////////////////////////////////////////////////////////////////////
+// i2cService - Moves the transaction on the bus on. Called from the
+//              UCB1 ISR or by polling.
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void i2cService(void) {
+    unsigned long state = halIrqSave();
+    int status;
+
+    if (i2cCount) {
+        status = halI2cService();
+        if (status != I2C_PENDING) {
+            i2cFinish(status);
+        }
+    }
+
+    halIrqRestore(state);
 }
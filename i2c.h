@@ -12,6 +12,7 @@
 #define TMP006_SLAVE_ADDRESS    0x40
 
 // TMP006 Register Addresses
+#define TMP006_VOLTAGE_REG      0x00    // thermopile voltage, its low bits are mostly noise
 #define TMP006_TEMPERATURE_REG  0x01
 #define TMP006_DEVICE_ID_REG    0xFF    // expected DEVICE ID will return 0x0067
 
@@ -22,6 +23,31 @@
 
 #define OPT3001_CONFIG_100      0xC410  // OPT3001 Configuration value for 100ms continuous sampling
 
+#define I2C_QUEUE_SIZE          4       // transactions that can be waiting at once
+
+// Status of a transaction
+#define I2C_OK                  0       // transaction complete
+#define I2C_PENDING             1       // transaction queued or on the bus
+#define I2C_ERR_QUEUE_FULL      -1      // transaction not submitted, queue is full
+#define I2C_ERR_NACK            -2      // slave did not acknowledge its address or data
+#define I2C_ERR_ARBITRATION     -3      // another master took the bus
+#define I2C_ERR_TIMEOUT         -4      // bus made no progress, transaction given up
+#define I2C_ERR_BUS_STUCK       -5      // SDA still held low after bus recovery
+
+// A transaction on the i2c bus: the register address and txLength bytes are
+// written, then if rxLength is not 0 a repeated start reads rxLength bytes.
+// The transaction must stay valid until its status is no longer I2C_PENDING.
+typedef struct i2cTransaction {
+    char slaveAddr;                                     // slave address of the device
+    char regAddr;                                       // 8-bit register address
+    const unsigned char *txData;                        // bytes written after the register address
+    int txLength;
+    unsigned char *rxData;                              // bytes read back from the register
+    int rxLength;
+    void (*callback)(struct i2cTransaction *transaction); // called on completion (may be from the ISR), or 0
+    volatile int status;                                // I2C_PENDING until complete
+} i2cTransaction;
+
 ///////////////////////////////////////////////////////////////////////
 // i2cInit - Initializes the UCB1 i2c interface
 // Arguments: none
@@ -29,21 +55,68 @@
 ///////////////////////////////////////////////////////////////////////
 void i2cInit(void);
 
+///////////////////////////////////////////////////////////////////////
+// i2cRecover - Frees the bus from a slave holding SDA low by clocking
+//              out SCL pulses on the pins as GPIO, then sending a stop
+// Arguments: none
+// Return Value: I2C_OK if SDA was released, I2C_ERR_BUS_STUCK if not
+///////////////////////////////////////////////////////////////////////
+int i2cRecover(void);
+
 ///////////////////////////////////////////////////////////////////////
 // i2cWrite - Sends a 16-bit word to a slave on the i2c bus
 // Arguments: slaveAddr - slave address of the device to receive the word
 //            regAddr - 8-bit register address to which the data is sent
 //            data - 16-bit data to be sent to slave device
-// Return Value: none
+// Return Value: I2C_OK or an I2C_ERR_ error code
 ///////////////////////////////////////////////////////////////////////
-void i2cWrite(char slaveAddr, char regAddr, int data);
+int i2cWrite(char slaveAddr, char regAddr, int data);
 
 ///////////////////////////////////////////////////////////////////////
 // i2cRead - Receives a 16-bit word from a slave on the i2c bus
 // Arguments: slaveAddr - slave address of the device to receive the word
 //            regAddr - 8-bit register address from which the data is read
-// Return Value:  16-bit data received from slave device
+//            data - set to the 16-bit data received from slave device
+// Return Value: I2C_OK or an I2C_ERR_ error code (data is left alone)
+///////////////////////////////////////////////////////////////////////
+int i2cRead(char slaveAddr, char regAddr, int *data);
+
+///////////////////////////////////////////////////////////////////////
+// i2cReadBurst - Receives several bytes from consecutive registers of a
+//                slave on the i2c bus
+// Arguments: slaveAddr - slave address of the device to receive from
+//            regAddr - 8-bit register address of the first byte read
+//            data - filled with the bytes read
+//            length - number of bytes to read
+// Return Value: I2C_OK or an I2C_ERR_ error code
+///////////////////////////////////////////////////////////////////////
+int i2cReadBurst(char slaveAddr, char regAddr, unsigned char *data, int length);
+
+///////////////////////////////////////////////////////////////////////
+// i2cSubmit - Queues a transaction to be carried out in the background
+//             by the UCB1 interrupt. Returns without waiting for it.
+// Arguments: transaction - transaction to carry out, status is set to
+//                          I2C_PENDING
+// Return Value: I2C_OK if queued, I2C_ERR_QUEUE_FULL if not
+///////////////////////////////////////////////////////////////////////
+int i2cSubmit(i2cTransaction *transaction);
+
+///////////////////////////////////////////////////////////////////////
+// i2cPoll - Gets the status of a submitted transaction. Moves the bus
+//           on itself if the UCB1 interrupt cannot run, so it is safe
+//           to call with interrupts disabled.
+// Arguments: transaction - submitted transaction
+// Return Value: status of the transaction
+///////////////////////////////////////////////////////////////////////
+int i2cPoll(i2cTransaction *transaction);
+
+///////////////////////////////////////////////////////////////////////
+// i2cWait - Waits for a submitted transaction to complete. If the
+//           transaction on the bus makes no progress for ~5ms it is
+//           given up with I2C_ERR_TIMEOUT and the bus is recovered.
+// Arguments: transaction - submitted transaction
+// Return Value: status of the transaction
 ///////////////////////////////////////////////////////////////////////
-int i2cRead(char slaveAddr, char regAddr);
+int i2cWait(i2cTransaction *transaction);
 
 #endif /* I2C_H_ */
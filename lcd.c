@@ -4,7 +4,7 @@
 // Set: N/A
 // Date: Feb 20, 2016 (created) (Edited Nov 3rd 2020)
 
-#include "msp.h"
+#include "hal.h"
 #include "lcd.h"
 
 // ST7735 LCD controller Command Set (copied from TI sample code)
@@ -27,6 +27,8 @@
 #define CM_RGBSET          0x2d
 #define CM_RAMRD           0x2E
 #define CM_PTLAR           0x30
+#define CM_VSCRDEF         0x33
+#define CM_VSCSAD          0x37
 #define CM_MADCTL          0x36
 #define CM_COLMOD          0x3A
 #define CM_SETPWCTR        0xB1
@@ -50,24 +52,80 @@
 #define X_CORRECTION_OFFSET 2
 #define Y_CORRECTION_OFFSET 1
 
-//  LCD pins
-#define LCD_SCK           BIT5  // P1.5 for UCB0 SCK connects to LCD SCK
-#define LCD_MOSI          BIT6  // P1.6 for UCB0 MOSI connects to LCD SDA
-#define LCD_RST           BIT7  // P5.7 connects to LCD RST pin
-#define LCD_CS            BIT0  // P5.0 connects to LCD CS pin
-#define LCD_DC            BIT7  // P3.7 connects to LCD DC pin
-
-// define # CPU cycles for delays
-#define _1ms (3000)
-#define _10ms (10 * _1ms)
-#define _50ms (50 * _1ms)
-#define _120ms (120 * _1ms)
-#define _200ms (200 * _1ms)
+#define PANEL_ROWS          162     // rows of the ST7735 frame memory, the scroll definition covers them all
 
 // Argument for isData in lcdWrite function
 #define DATA 1
 #define CMD 0
 
+// DMA transmit queue, runs are sent through halSpiDmaStart
+#define DMA_QUEUE_SIZE      8       // runs that can be queued at once
+#define DMA_FILL_PIXELS     64      // pixels in the buffer used for single colour runs
+
+// A run of command or data bytes waiting to be sent by the DMA
+typedef struct {
+    const unsigned char *data;
+    int length;
+    int repeat;
+    int isData;
+} dmaRun;
+
+static dmaRun dmaQueue[DMA_QUEUE_SIZE];     // ring of queued runs, dmaHead is being sent
+static volatile int dmaHead, dmaCount;
+static volatile int dmaOffset;              // bytes of the current pass of dmaHead already sent
+static volatile int dmaChunk;               // bytes in the DMA cycle in flight
+static void (*dmaCallback)(void);
+static unsigned char dmaFill[2 * DMA_FILL_PIXELS];
+
+// Current address window (set by lcdSetWindow) and the position of the next
+// pixel streamed into it.  Only tracked when the window is partly off screen,
+// or always in framebuffer mode.
+static int windowX0, windowX1;
+static int windowX, windowY;
+static int windowClipped;  // true if some pixels of the window are off screen
+
+// Part of the window that is on screen.  The panel is sent it in pieces of rows
+// that follow on in its memory, more than one only if the window crosses an edge
+// of the scroll area or the row the scroll area wraps at.
+static int windowClipX0, windowClipX1, windowClipY1;
+static int pieceY1;         // last row of the piece the panel is being sent
+static int pieceLeft;       // pixels of the piece not streamed yet
+
+// Vertical scroll area (lcdScrollArea), rows scrollY0 up of the screen, and how far
+// its contents have been moved down (lcdScroll).  Screen row scrollY0 + i is kept in
+// row (i + scrollOffset) % scrollRows of the area in panel memory.
+static int scrollY0;
+static int scrollRows;      // 0 for no scroll area
+static int scrollOffset;
+
+#ifdef LCD_FRAMEBUFFER
+#ifdef LCD_FRAMEBUFFER_4BPP
+#define PALETTE_SIZE        16      // colours a 4 bit index can pick
+#define FLUSH_PIXELS        256     // pixels expanded by lcdFlush per DMA run
+
+// Copy of the screen, drawn into instead of the panel and sent by lcdFlush.  Kept in
+// the order the panel is written (rows from y = 0, each row from x = LCD_MAX_X down),
+// as palette indexes, two pixels per byte with the one sent first in the top nibble.
+static unsigned char frame[LCD_MAX_Y + 1][(LCD_MAX_X + 1) / 2];
+
+// RGB565 colour of each index, filled as colours are first drawn and emptied by lcdClear
+static unsigned short palette[PALETTE_SIZE];
+static int paletteCount;
+
+// Rows expanded to RGB565 by lcdFlush, one is filled while the DMA sends the other
+static unsigned char flushBuffer[2][2 * FLUSH_PIXELS];
+#else
+// Copy of the screen, drawn into instead of the panel and sent by lcdFlush.  Kept in
+// the order the panel is written (rows from y = 0, each row from x = LCD_MAX_X down),
+// two bytes per pixel MSB first, so any part of a row goes out as one DMA run.
+static unsigned char frame[LCD_MAX_Y + 1][2 * (LCD_MAX_X + 1)];
+#endif
+
+// Part of each row drawn since it was last sent, clean when dirtyX0 > dirtyX1
+static unsigned char dirtyX0[LCD_MAX_Y + 1];
+static unsigned char dirtyX1[LCD_MAX_Y + 1];
+#endif
+
 ///////////////////////////////////////////////////////////////////////
 // lcdWrite - Sends a command/data byte to the LCD.
 // Arguments: byte - value to be sent to the LCD
@@ -76,49 +134,115 @@
 ///////////////////////////////////////////////////////////////////////
 void lcdWrite(char byte, int isData);
 
+///////////////////////////////////////////////////////////////////////
+// lcdCommand - Sends a command and its parameters, the parameters back
+//              to back with the data/command pin set once
+// Arguments: command - command byte
+//            params - parameter bytes
+//            count - number of parameters (0 for none)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void lcdCommand(unsigned char command, const unsigned char *params, int count);
 
 ///////////////////////////////////////////////////////////////////////
-// lcdInit - Initializes ports, SPI settings and LCD.
-//           This function assumes CPU clock is less than 15MHz.
+// dmaPoll - Advances the DMA queue if the DMA cycle in flight is done
 // Arguments: none
 // Return Value: none
 ///////////////////////////////////////////////////////////////////////
-void lcdInit()
-{
-    // enable pins for UCB0 SPI MOSI/SCK 
-    P1->SEL1 &= ~(LCD_SCK | LCD_MOSI);
-    P1->SEL0 |= (LCD_SCK | LCD_MOSI);
+static void dmaPoll(void);
+
+///////////////////////////////////////////////////////////////////////
+// panelWindow - Sets the address window of the panel and starts a RAMWR
+// Arguments: x0, y0 - bottom left corner of the window (on screen)
+//            x1, y1 - top right corner of the window (inclusive), its
+//                     rows must follow on in panel memory
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void panelWindow(int x0, int y0, int x1, int y1);
 
-    // enable CS, RST and DC outputs
-    P5->DIR |= LCD_CS;      // LCD Chip Select P5.0 set to OUT
-    P5->DIR |= LCD_RST;     // LCD RST P5.7 set to OUT
-    P3->DIR |= LCD_DC;      // LCD Data/Command P3.7 set to OUT
+///////////////////////////////////////////////////////////////////////
+// panelRow - Gets the row of the panel's memory a screen row is kept in
+// Arguments: y - screen row
+// Return Value: row of the panel
+///////////////////////////////////////////////////////////////////////
+static int panelRow(int y);
 
-    // activate CS (check data sheet.  Is this active high or low?)
-    P5->OUT &= ~LCD_CS;
+///////////////////////////////////////////////////////////////////////
+// windowPiece - Sends the panel the next piece of the current window:
+//               the rows from y on that follow on in its memory
+// Arguments: y - first row of the piece (on screen)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void windowPiece(int y);
 
-    // ensure UCB0 SPI module in software reset
-    EUSCI_B0_SPI->CTLW0 |= EUSCI_B_CTLW0_SWRST;
+///////////////////////////////////////////////////////////////////////
+// panelPixels - Sends a run of pixels of the same colour straight to
+//               the panel, into the RAMWR already started
+// Arguments: colour - A 16 bit RGB colour
+//            count - number of pixels in the run
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void panelPixels(int colour, int count);
 
-	// configure SPI as master, MSB first, SMCLK as clock source data, captured on first clock edge
-    EUSCI_B0_SPI->CTLW0 |= (EUSCI_B_CTLW0_MST | EUSCI_B_CTLW0_MSB | EUSCI_A_CTLW0_UCSSEL_2 | EUSCI_A_CTLW0_CKPH);
+#ifdef LCD_FRAMEBUFFER
+///////////////////////////////////////////////////////////////////////
+// frameDirty - Marks a rectangle of the copy of the screen as drawn
+// Arguments: x0, y0 - bottom left corner of the rectangle (on screen)
+//            x1, y1 - top right corner of the rectangle (inclusive)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void frameDirty(int x0, int y0, int x1, int y1);
 
-    // configure SPI as low clock inactive state
-    EUSCI_B0_SPI->CTLW0  &= ~EUSCI_A_CTLW0_CKPL;
+///////////////////////////////////////////////////////////////////////
+// frameValue - Gets what is stored in the copy of the screen for a
+//              colour: the colour itself, or its palette index
+// Arguments: colour - A 16 bit RGB colour
+// Return Value: value to pass to framePut
+///////////////////////////////////////////////////////////////////////
+static int frameValue(int colour);
+
+///////////////////////////////////////////////////////////////////////
+// framePut - Stores one pixel in the copy of the screen
+// Arguments: column - column of the panel (LCD_MAX_X - x)
+//            y - row of the pixel
+//            value - returned by frameValue
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void framePut(int column, int y, int value);
 
-    // take UCB0 SPI module out of software reset
-    EUSCI_B0_SPI->CTLW0 &= ~EUSCI_B_CTLW0_SWRST;
+///////////////////////////////////////////////////////////////////////
+// frameSend - Sends a rectangle of the copy of the screen to the panel
+//             as one window and one RAMWR burst
+// Arguments: x0, y0 - bottom left corner of the rectangle (on screen)
+//            x1, y1 - top right corner of the rectangle (inclusive)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void frameSend(int x0, int y0, int x1, int y1);
+#endif
 
 
+///////////////////////////////////////////////////////////////////////
+// lcdInit - Initializes ports, SPI settings and LCD.
+//           halInit must have set up the clocks first, the SPI runs
+//           from SMCLK and stays under CLOCK_SPI_MAX (15MHz).
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdInit()
+{
+    // SPI, LCD control pins and the DMA feeding the SPI
+    halSpiInit();
+    halSpiDmaOnDone(dmaPoll);
+
     // Reset the display with hardware reset
-    P5->OUT &= ~LCD_RST;
-    __delay_cycles(_50ms);
-    P5->OUT |= LCD_RST;
-    __delay_cycles(_120ms);
+    halLcdReset(1);
+    halDelayMs(50);
+    halLcdReset(0);
+    halDelayMs(120);
 
     // Command ST7735 Sleep; out and booster on
     lcdWrite(CM_SLPOUT, CMD);
-    __delay_cycles(_120ms);
+    halDelayMs(120);
 
     // Gamma curve select
     lcdWrite(CM_GAMSET, CMD);
@@ -137,7 +261,7 @@ void lcdInit()
     // Interface Pixel Format -> 16bit/Pixel
     lcdWrite(CM_COLMOD, CMD);
     lcdWrite(0x05, DATA);
-    __delay_cycles(_10ms);
+    halDelayMs(10);
 
     // Memory Access Data Control -> Blue, Green, Red Colour Filter (Order of bits read)
     lcdWrite(CM_MADCTL, CMD);
@@ -148,9 +272,10 @@ void lcdInit()
 
     // clear the display
     lcdClear(WHITE);
+    lcdFlush(0, 0, LCD_MAX_X, LCD_MAX_Y);
 
     // turn on the display
-     __delay_cycles(_10ms);
+    halDelayMs(10);
     lcdWrite(CM_DISPON, CMD);
 }
 
@@ -161,32 +286,49 @@ void lcdInit()
 // Return Value: none
 ///////////////////////////////////////////////////////////////////////
 void lcdClear(int colour) {
-	int row, col;  // variables used to track current pixel while clearing
-
-	// set x range
-	lcdWrite(CM_CASET, CMD);
-	lcdWrite(0, DATA);
-	lcdWrite(X_CORRECTION_OFFSET, DATA);
-	lcdWrite(0, DATA);
-	lcdWrite(LCD_MAX_X + X_CORRECTION_OFFSET, DATA);
-
-	// set y range
-	lcdWrite(CM_RASET, CMD);
-	lcdWrite(0, DATA);
-	lcdWrite(Y_CORRECTION_OFFSET, DATA);
-	lcdWrite(0, DATA);
-	lcdWrite(LCD_MAX_Y + Y_CORRECTION_OFFSET, DATA);
-
-	// clear all pixels in range
-    lcdWrite(CM_RAMWR, CMD);
-    for (row = 0; row <= LCD_MAX_Y; row++) {
-        for (col = 0; col <= LCD_MAX_X; col++) {
-        	// clear to desired colour
-	        lcdWrite(colour >> 8, DATA);
-            lcdWrite(colour, DATA);
-        }
+
+#ifdef LCD_FRAMEBUFFER_4BPP
+    // nothing drawn before is left, so every palette entry is free again
+    paletteCount = 0;
+#endif
+
+    // nothing scrolled is kept either, start the scroll area over unmoved
+    if(scrollOffset) {
+        lcdScroll(0 - scrollOffset);
     }
 
+    // fill the entire display with the colour
+    lcdFillRect(0, 0, LCD_MAX_X, LCD_MAX_Y, colour);
+
+}
+
+///////////////////////////////////////////////////////////////////////
+// lcdFillRect - Fills a rectangle of the display with a single colour.
+//               The rectangle is clipped to the display, so it may be
+//               partly (or completely) off screen.
+// Arguments: x0, y0 - bottom left corner of the rectangle
+//            x1, y1 - top right corner of the rectangle (inclusive)
+//            colour - A 16 bit value to represent the RGB colour to
+//                     fill the rectangle with
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdFillRect(int x0, int y0, int x1, int y1, int colour) {
+
+    // clip the rectangle to the display
+    if(x0 < 0) x0 = 0;
+    if(y0 < 0) y0 = 0;
+    if(x1 > LCD_MAX_X) x1 = LCD_MAX_X;
+    if(y1 > LCD_MAX_Y) y1 = LCD_MAX_Y;
+
+    // nothing left to fill
+    if(x0 > x1 || y0 > y1) {
+        return;
+    }
+
+    // set the window once, then stream every pixel of the rectangle
+    lcdSetWindow(x0, y0, x1, y1);
+    lcdPushPixels(colour, (x1 - x0 + 1) * (y1 - y0 + 1));
+
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -201,27 +343,604 @@ void lcdClear(int colour) {
 void lcdSetPixel(int old_x, int y, int colour) {
 
     int x = LCD_MAX_X-old_x;
+    unsigned char params[4];    // CASET/RASET start and end, MSB first
+    unsigned char pixel[2];     // colour, MSB first
+
+#ifdef LCD_FRAMEBUFFER
+    // only the copy of the screen is written, lcdFlush sends it
+    if(old_x < 0 || old_x > LCD_MAX_X || y < 0 || y > LCD_MAX_Y) {
+        return;
+    }
+    lcdDmaWait();
+    framePut(x, y, frameValue(colour));
+    frameDirty(old_x, y, old_x, y);
+    return;
+#endif
 
 	// set x co-ordinate (column) for the pixel
-	lcdWrite(CM_CASET, CMD);
-	lcdWrite(0, DATA);
-	lcdWrite(x + X_CORRECTION_OFFSET, DATA);
-	lcdWrite(0, DATA);
-	lcdWrite(x + X_CORRECTION_OFFSET, DATA);
+    params[0] = params[2] = 0;
+    params[1] = params[3] = x + X_CORRECTION_OFFSET;
+    lcdCommand(CM_CASET, params, sizeof(params));
 
 	// set y co-ordinate (row) for the pixel
-	lcdWrite(CM_RASET, CMD);
-	lcdWrite(0, DATA);
-	lcdWrite(y + Y_CORRECTION_OFFSET, DATA);
-	lcdWrite(0, DATA);
-	lcdWrite(y + Y_CORRECTION_OFFSET, DATA);
+    params[1] = params[3] = panelRow(y);
+    lcdCommand(CM_RASET, params, sizeof(params));
 
 	// output colour to the pixel location
-    lcdWrite(CM_RAMWR, CMD);
-    lcdWrite(colour >> 8, DATA);
-    lcdWrite(colour, DATA);
+    pixel[0] = colour >> 8;
+    pixel[1] = colour;
+    lcdCommand(CM_RAMWR, pixel, sizeof(pixel));
+}
+
+///////////////////////////////////////////////////////////////////////
+// lcdSetWindow - Sets the address window that the following calls to
+//                lcdPushPixels stream into.  Pixels are streamed row by
+//                row from y0 up to y1, and each row runs from x1 down to
+//                x0 (the x axis of the display is mirrored).
+//                The window may be partly off screen, pixels falling
+//                outside of the display are dropped by lcdPushPixels.
+// Arguments: x0, y0 - bottom left corner of the window
+//            x1, y1 - top right corner of the window (inclusive)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdSetWindow(int x0, int y0, int x1, int y1) {
+
+    int clipX0, clipY0, clipX1, clipY1; // part of the window that is on screen
+
+    windowX0 = x0;
+    windowX1 = x1;
+
+    // the first pixel streamed is the top of the mirrored row, so x1
+    windowX = x1;
+    windowY = y0;
+
+    // clip the window to the display
+    clipX0 = (x0 < 0) ? 0 : x0;
+    clipY0 = (y0 < 0) ? 0 : y0;
+    clipX1 = (x1 > LCD_MAX_X) ? LCD_MAX_X : x1;
+    clipY1 = (y1 > LCD_MAX_Y) ? LCD_MAX_Y : y1;
+
+    windowClipped = (clipX0 != x0 || clipY0 != y0 || clipX1 != x1 || clipY1 != y1);
+    windowClipX0 = clipX0;
+    windowClipX1 = clipX1;
+    windowClipY1 = clipY1;
+
+    // window is completely off screen, lcdPushPixels will drop everything
+    if(clipX0 > clipX1 || clipY0 > clipY1) {
+        return;
+    }
+
+#ifdef LCD_FRAMEBUFFER
+    // the copy of the screen must not change under a flush still being sent
+    lcdDmaWait();
+    frameDirty(clipX0, clipY0, clipX1, clipY1);
+#else
+    windowPiece(clipY0);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////
+// panelRow - Gets the row of the panel's memory a screen row is kept in
+// Arguments: y - screen row
+// Return Value: row of the panel
+///////////////////////////////////////////////////////////////////////
+static int panelRow(int y) {
+
+    if(y >= scrollY0 && y < scrollY0 + scrollRows) {
+        y = scrollY0 + (y - scrollY0 + scrollOffset) % scrollRows;
+    }
+    return y + Y_CORRECTION_OFFSET;
+}
+
+///////////////////////////////////////////////////////////////////////
+// windowPiece - Sends the panel the next piece of the current window:
+//               the rows from y on that follow on in its memory
+// Arguments: y - first row of the piece (on screen)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void windowPiece(int y) {
+
+    int wrapY;  // last row before the scroll area wraps in memory
+
+    pieceY1 = windowClipY1;
+
+    // a piece ends at the bottom edge of the scroll area, or where the area wraps
+    if(scrollOffset && y < scrollY0 && pieceY1 >= scrollY0) {
+        pieceY1 = scrollY0 - 1;
+    } else if(scrollOffset && y >= scrollY0 && y < scrollY0 + scrollRows) {
+        wrapY = y + scrollRows - 1 - (y - scrollY0 + scrollOffset) % scrollRows;
+        if(pieceY1 > wrapY) {
+            pieceY1 = wrapY;
+        }
+    }
+
+    pieceLeft = (windowClipX1 - windowClipX0 + 1) * (pieceY1 - y + 1);
+    panelWindow(windowClipX0, y, windowClipX1, pieceY1);
+}
+
+///////////////////////////////////////////////////////////////////////
+// panelWindow - Sets the address window of the panel and starts a RAMWR
+// Arguments: x0, y0 - bottom left corner of the window (on screen)
+//            x1, y1 - top right corner of the window (inclusive), its
+//                     rows must follow on in panel memory
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void panelWindow(int x0, int y0, int x1, int y1) {
+
+    unsigned char params[4];    // start and end, MSB first
+
+	// set x range (mirrored, so the columns are LCD_MAX_X-x1 to LCD_MAX_X-x0)
+    params[0] = params[2] = 0;
+    params[1] = LCD_MAX_X - x1 + X_CORRECTION_OFFSET;
+    params[3] = LCD_MAX_X - x0 + X_CORRECTION_OFFSET;
+    lcdCommand(CM_CASET, params, sizeof(params));
+
+	// set y range, where the rows are kept in panel memory
+    params[1] = panelRow(y0);
+    params[3] = params[1] + y1 - y0;
+    lcdCommand(CM_RASET, params, sizeof(params));
+
+	// following data bytes are written into the window
+    lcdCommand(CM_RAMWR, 0, 0);
 }
 
+///////////////////////////////////////////////////////////////////////
+// lcdPushPixels - Streams a run of pixels of the same colour into the
+//                 window set by lcdSetWindow
+// Arguments: colour - A 16 bit value to represent the RGB colour of
+//                     the run
+//            count - number of pixels in the run
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdPushPixels(int colour, int count) {
+
+#ifdef LCD_FRAMEBUFFER
+    // every pixel goes into the copy of the screen, the panel is written by lcdFlush
+    colour = frameValue(colour);
+    while(count-- > 0) {
+        if(!windowClipped || (windowX >= 0 && windowX <= LCD_MAX_X && windowY >= 0 && windowY <= LCD_MAX_Y)) {
+            framePut(LCD_MAX_X - windowX, windowY, colour);
+        }
+
+        // move to the next pixel, wrapping to the start of the next row
+        windowX--;
+        if(windowX < windowX0) {
+            windowX = windowX1;
+            windowY++;
+        }
+    }
+    return;
+#endif
+
+    // window is fully on screen, every pixel goes straight to the LCD
+    if(!windowClipped) {
+
+        // the run may go on into the next piece of the window
+        while(count > pieceLeft && pieceY1 < windowClipY1) {
+            panelPixels(colour, pieceLeft);
+            count -= pieceLeft;
+            windowPiece(pieceY1 + 1);
+        }
+        pieceLeft -= count;
+        panelPixels(colour, count);
+        return;
+    }
+
+    // window is partly off screen, only send the pixels that land on the display
+    while(count-- > 0) {
+        if(windowX >= 0 && windowX <= LCD_MAX_X && windowY >= 0 && windowY <= LCD_MAX_Y) {
+            if(windowY > pieceY1) {
+                windowPiece(windowY);
+            }
+            lcdWrite(colour >> 8, DATA);
+            lcdWrite(colour, DATA);
+        }
+
+        // move to the next pixel, wrapping to the start of the next row
+        windowX--;
+        if(windowX < windowX0) {
+            windowX = windowX1;
+            windowY++;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// panelPixels - Sends a run of pixels of the same colour straight to
+//               the panel, into the RAMWR already started
+// Arguments: colour - A 16 bit RGB colour
+//            count - number of pixels in the run
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void panelPixels(int colour, int count) {
+
+    int pixel; // index into the DMA fill buffer
+
+    // long runs are handed to the DMA and sent in the background
+    if(count >= DMA_FILL_PIXELS) {
+
+        // fill buffer may still be in use by the previous run
+        lcdDmaWait();
+        for(pixel = 0; pixel < DMA_FILL_PIXELS; pixel++) {
+            dmaFill[2 * pixel] = colour >> 8;
+            dmaFill[2 * pixel + 1] = colour;
+        }
+
+        lcdDmaQueue(dmaFill, sizeof(dmaFill), count / DMA_FILL_PIXELS, DATA);
+        if(count % DMA_FILL_PIXELS) {
+            lcdDmaQueue(dmaFill, 2 * (count % DMA_FILL_PIXELS), 1, DATA);
+        }
+        return;
+    }
+
+    // short runs are sent straight away, pixel pairs back to back from the fill buffer
+    if(count > 0) {
+        lcdDmaWait();
+        for(pixel = 0; pixel < count; pixel++) {
+            dmaFill[2 * pixel] = colour >> 8;
+            dmaFill[2 * pixel + 1] = colour;
+        }
+        halSpiWriteRun(dmaFill, 2 * count, DATA);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// lcdScrollArea - Sets the rows of the screen that lcdScroll moves,
+//                 the rows below and above stay where they are.  The
+//                 area starts out unmoved, anything scrolled before
+//                 must be drawn again.  Does nothing when built with
+//                 LCD_FRAMEBUFFER.
+// Arguments: y0 - bottom row of the area
+//            y1 - top row of the area (inclusive), below y0 for none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdScrollArea(int y0, int y1) {
+
+#ifndef LCD_FRAMEBUFFER
+    unsigned char params[6];    // rows below, in and above the area, MSB first
+
+    // move the old area back first, so every row is where it is drawn again
+    if(scrollOffset) {
+        lcdScroll(0 - scrollOffset);
+    }
+
+    // clip the area to the display
+    if(y0 < 0) y0 = 0;
+    if(y1 > LCD_MAX_Y) y1 = LCD_MAX_Y;
+    if(y0 > y1) {
+        y0 = 0;
+        y1 = -1;
+    }
+    scrollY0 = y0;
+    scrollRows = y1 - y0 + 1;
+
+    // the panel counts fixed rows on either side in its own memory, off screen rows
+    // included.  No area is its reset state, all of memory scrolled by nothing.
+    params[0] = params[2] = params[4] = 0;
+    params[1] = scrollRows ? y0 + Y_CORRECTION_OFFSET : 0;
+    params[3] = scrollRows ? scrollRows : PANEL_ROWS;
+    params[5] = PANEL_ROWS - params[1] - params[3];
+    lcdCommand(CM_VSCRDEF, params, sizeof(params));
+#endif
+
+}
+
+///////////////////////////////////////////////////////////////////////
+// lcdScroll - Moves everything in the scroll area down, by changing
+//             the row of panel memory the panel shows first rather
+//             than sending the pixels again.  Rows leaving the bottom
+//             of the area come back in at its top, until drawn over.
+//             Drawing is still done in screen rows, the driver sends
+//             each row to wherever the area keeps it.  lcdClear moves
+//             the area back.
+// Arguments: dy - rows to move down (negative moves up)
+// Return Value: true if scrolled, false if there is no scroll area or
+//               the driver is built with LCD_FRAMEBUFFER, the moved
+//               pixels must then be drawn instead
+///////////////////////////////////////////////////////////////////////
+int lcdScroll(int dy) {
+
+    unsigned char params[2];    // panel row shown at the bottom of the area, MSB first
+
+    if(!scrollRows) {
+        return 0;
+    }
+
+    scrollOffset = ((scrollOffset + dy) % scrollRows + scrollRows) % scrollRows;
+
+    params[0] = 0;
+    params[1] = scrollY0 + scrollOffset + Y_CORRECTION_OFFSET;
+    lcdCommand(CM_VSCSAD, params, sizeof(params));
+    return 1;
+
+}
+
+///////////////////////////////////////////////////////////////////////
+// lcdPartial - Shows only some rows of the screen (partial mode), the
+//              panel blanks the rest and stops refreshing them, which
+//              saves power.  Panel memory outside the rows keeps
+//              what was drawn there.
+// Arguments: y0 - bottom row shown
+//            y1 - top row shown (inclusive)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdPartial(int y0, int y1) {
+
+    unsigned char params[4];    // first and last panel row shown, MSB first
+
+    if(y0 < 0) y0 = 0;
+    if(y1 > LCD_MAX_Y) y1 = LCD_MAX_Y;
+
+    params[0] = params[2] = 0;
+    params[1] = y0 + Y_CORRECTION_OFFSET;
+    params[3] = y1 + Y_CORRECTION_OFFSET;
+    lcdCommand(CM_PTLAR, params, sizeof(params));
+    lcdCommand(CM_PTLON, 0, 0);
+
+    // changing mode leaves the scroll, pick it up where it was
+    if(scrollOffset) {
+        lcdScroll(0);
+    }
+
+}
+
+///////////////////////////////////////////////////////////////////////
+// lcdNormal - Shows the whole screen again after lcdPartial
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdNormal(void) {
+
+    lcdCommand(CM_NORON, 0, 0);
+
+    // changing mode leaves the scroll, pick it up where it was
+    if(scrollOffset) {
+        lcdScroll(0);
+    }
+
+}
+
+///////////////////////////////////////////////////////////////////////
+// lcdFlush - Sends the parts of a rectangle drawn since they were last
+//            sent to the panel.  Each band of drawn rows goes out as one
+//            window and one RAMWR burst, queued for the DMA.  Does
+//            nothing unless built with LCD_FRAMEBUFFER, drawing then
+//            goes straight to the panel.
+// Arguments: x0, y0 - bottom left corner of the rectangle
+//            x1, y1 - top right corner of the rectangle (inclusive)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdFlush(int x0, int y0, int x1, int y1) {
+
+#ifdef LCD_FRAMEBUFFER
+    int y;                  // row checked
+    int bandY0 = -1;        // first row of the band being built, -1 for none
+    int bandX0 = 0;         // columns of the band, every drawn part of its rows
+    int bandX1 = 0;
+    int spanX0, spanX1;     // drawn part of the row, within the rectangle
+
+    // clip the rectangle to the display
+    if(x0 < 0) x0 = 0;
+    if(y0 < 0) y0 = 0;
+    if(x1 > LCD_MAX_X) x1 = LCD_MAX_X;
+    if(y1 > LCD_MAX_Y) y1 = LCD_MAX_Y;
+
+    // one past the last row closes the last band
+    for(y = y0; y <= y1 + 1; y++) {
+
+        spanX0 = LCD_MAX_X + 1;
+        spanX1 = -1;
+        if(y <= y1 && dirtyX0[y] <= dirtyX1[y]) {
+            spanX0 = (dirtyX0[y] > x0) ? dirtyX0[y] : x0;
+            spanX1 = (dirtyX1[y] < x1) ? dirtyX1[y] : x1;
+        }
+
+        // row has something to send: add it to the band
+        if(spanX0 <= spanX1) {
+            if(bandY0 < 0) {
+                bandY0 = y;
+                bandX0 = spanX0;
+                bandX1 = spanX1;
+            }
+            if(spanX0 < bandX0) bandX0 = spanX0;
+            if(spanX1 > bandX1) bandX1 = spanX1;
+
+            // what is left to send of the row, it stays drawn if the rectangle splits it
+            if(x0 <= dirtyX0[y]) {
+                dirtyX0[y] = (x1 < LCD_MAX_X) ? x1 + 1 : LCD_MAX_X + 1;
+            } else if(x1 >= dirtyX1[y]) {
+                dirtyX1[y] = x0 - 1;
+            }
+            if(dirtyX0[y] > dirtyX1[y]) {
+                dirtyX0[y] = LCD_MAX_X + 1;
+                dirtyX1[y] = 0;
+            }
+            continue;
+        }
+
+        // row is clean: send the band before it, if any
+        if(bandY0 < 0) {
+            continue;
+        }
+
+        frameSend(bandX0, bandY0, bandX1, y - 1);
+        bandY0 = -1;
+    }
+#endif
+
+}
+
+#ifdef LCD_FRAMEBUFFER
+///////////////////////////////////////////////////////////////////////
+// frameDirty - Marks a rectangle of the copy of the screen as drawn
+// Arguments: x0, y0 - bottom left corner of the rectangle (on screen)
+//            x1, y1 - top right corner of the rectangle (inclusive)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void frameDirty(int x0, int y0, int x1, int y1) {
+
+    int y;
+
+    for(y = y0; y <= y1; y++) {
+        if(x0 < dirtyX0[y]) dirtyX0[y] = x0;
+        if(x1 > dirtyX1[y]) dirtyX1[y] = x1;
+    }
+}
+
+#ifdef LCD_FRAMEBUFFER_4BPP
+///////////////////////////////////////////////////////////////////////
+// frameValue - Gets the palette index of a colour, adding the colour to
+//              the palette if it is new.  Once all PALETTE_SIZE entries
+//              are taken, new colours get the index of the closest one.
+// Arguments: colour - A 16 bit RGB colour
+// Return Value: palette index
+///////////////////////////////////////////////////////////////////////
+static int frameValue(int colour) {
+
+    int index;
+    int best = 0;
+    long distance, bestDistance = -1;
+    int red, green, blue;
+
+    colour &= 0xFFFF;
+    for(index = 0; index < paletteCount; index++) {
+        if(palette[index] == colour) {
+            return index;
+        }
+    }
+
+    if(paletteCount < PALETTE_SIZE) {
+        palette[paletteCount] = colour;
+        return paletteCount++;
+    }
+
+    // palette full: closest colour, green counting half as much per step as it has twice the steps
+    for(index = 0; index < PALETTE_SIZE; index++) {
+        red = (colour >> 11) - (palette[index] >> 11);
+        green = ((colour >> 5) & 0x3F) - ((palette[index] >> 5) & 0x3F);
+        blue = (colour & 0x1F) - (palette[index] & 0x1F);
+        distance = 4L * red * red + (long)green * green + 4L * blue * blue;
+        if(bestDistance < 0 || distance < bestDistance) {
+            bestDistance = distance;
+            best = index;
+        }
+    }
+    return best;
+}
+
+///////////////////////////////////////////////////////////////////////
+// framePut - Stores one pixel in the copy of the screen
+// Arguments: column - column of the panel (LCD_MAX_X - x)
+//            y - row of the pixel
+//            value - palette index
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void framePut(int column, int y, int value) {
+
+    unsigned char *pair = &frame[y][column / 2];
+
+    if(column & 1) {
+        *pair = (*pair & 0xF0) | value;
+    } else {
+        *pair = (*pair & 0x0F) | (value << 4);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// frameSend - Sends a rectangle of the copy of the screen to the panel
+//             as one window and one RAMWR burst, expanding the palette
+//             indexes to RGB565 a few rows at a time
+// Arguments: x0, y0 - bottom left corner of the rectangle (on screen)
+//            x1, y1 - top right corner of the rectangle (inclusive)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void frameSend(int x0, int y0, int x1, int y1) {
+
+    int columnStart = LCD_MAX_X - x1;   // first column of each row sent
+    int columnEnd = LCD_MAX_X - x0;
+    int buffer = 0;                     // flushBuffer being filled
+    int fill = 0;                       // bytes in it
+    int column, y;
+    unsigned short colour;
+    unsigned char *out;
+
+    // waits for anything queued before, so both buffers are free
+    panelWindow(x0, y0, x1, y1);
+
+    for(y = y0; y <= y1; y++) {
+
+        // row does not fit: send the buffer and fill the other one once the DMA is done with it
+        if(fill + 2 * (columnEnd - columnStart + 1) > (int)sizeof(flushBuffer[0])) {
+            lcdDmaQueue(flushBuffer[buffer], fill, 1, DATA);
+            buffer ^= 1;
+            fill = 0;
+            while(dmaCount > 1) {
+                dmaPoll();
+            }
+        }
+
+        out = &flushBuffer[buffer][fill];
+        for(column = columnStart; column <= columnEnd; column++) {
+            colour = palette[(column & 1) ? (frame[y][column / 2] & 0x0F) : (frame[y][column / 2] >> 4)];
+            *out++ = colour >> 8;
+            *out++ = colour;
+        }
+        fill = out - flushBuffer[buffer];
+    }
+
+    lcdDmaQueue(flushBuffer[buffer], fill, 1, DATA);
+}
+#else
+///////////////////////////////////////////////////////////////////////
+// frameValue - Gets what is stored in the copy of the screen for a
+//              colour, the colour itself in RGB565
+// Arguments: colour - A 16 bit RGB colour
+// Return Value: value to pass to framePut
+///////////////////////////////////////////////////////////////////////
+static int frameValue(int colour) {
+
+    return colour;
+}
+
+///////////////////////////////////////////////////////////////////////
+// framePut - Stores one pixel in the copy of the screen
+// Arguments: column - column of the panel (LCD_MAX_X - x)
+//            y - row of the pixel
+//            value - RGB565 colour
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void framePut(int column, int y, int value) {
+
+    frame[y][2 * column] = value >> 8;
+    frame[y][2 * column + 1] = value;
+}
+
+///////////////////////////////////////////////////////////////////////
+// frameSend - Sends a rectangle of the copy of the screen to the panel
+//             as one window and one RAMWR burst, the rows straight from
+//             the frame
+// Arguments: x0, y0 - bottom left corner of the rectangle (on screen)
+//            x1, y1 - top right corner of the rectangle (inclusive)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void frameSend(int x0, int y0, int x1, int y1) {
+
+    int y;
+
+    panelWindow(x0, y0, x1, y1);
+
+    if(x0 == 0 && x1 == LCD_MAX_X) {
+        // whole rows follow each other in the frame
+        lcdDmaQueue(frame[y0], (y1 - y0 + 1) * sizeof(frame[0]), 1, DATA);
+    } else {
+        for(y = y0; y <= y1; y++) {
+            lcdDmaQueue(&frame[y][2 * (LCD_MAX_X - x1)], 2 * (x1 - x0 + 1), 1, DATA);
+        }
+    }
+}
+#endif /* LCD_FRAMEBUFFER_4BPP */
+#endif
+
 ///////////////////////////////////////////////////////////////////////
 // lcdWrite - Sends a command/data byte to the LCD.
 // Arguments: byte - value to be sent to the LCD
@@ -231,22 +950,161 @@ void lcdSetPixel(int old_x, int y, int colour) {
 void lcdWrite(char byte, int isData)
 {
 
-    // poll UCBUSY register bit to determine if finished transmitting previous byte 
-	while(EUSCI_B0_SPI->STATW & EUSCI_B_STATW_SPI_BUSY) { }
-	
-    // if byte is data
-	if(isData == 1) {
+    // let the DMA finish anything queued before it
+    lcdDmaWait();
+
+    // waits for the previous byte, sets the data/command pin and transmits
+    halSpiWrite(byte, isData);
+
+}
+
+///////////////////////////////////////////////////////////////////////
+// lcdCommand - Sends a command and its parameters, the parameters back
+//              to back with the data/command pin set once
+// Arguments: command - command byte
+//            params - parameter bytes
+//            count - number of parameters (0 for none)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void lcdCommand(unsigned char command, const unsigned char *params, int count)
+{
+
+    lcdWrite(command, CMD);
+    if(count > 0) {
+        halSpiWriteRun(params, count, DATA);
+    }
+
+}
+
+///////////////////////////////////////////////////////////////////////
+// dmaStart - Starts a DMA cycle for the next chunk of the run at the
+//            head of the queue
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void dmaStart(void)
+{
+    dmaRun *run = &dmaQueue[dmaHead];
+    int chunk = run->length - dmaOffset;
+
+    if(chunk > HAL_DMA_MAX_LENGTH) {
+        chunk = HAL_DMA_MAX_LENGTH;
+    }
+    dmaChunk = chunk;
+
+    halSpiDmaStart(run->data + dmaOffset, chunk, run->isData);
+}
+
+///////////////////////////////////////////////////////////////////////
+// dmaPoll - Advances the DMA queue if the DMA cycle in flight is done
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void dmaPoll(void)
+{
+    unsigned long state = halIrqSave();
+    dmaRun *run;
+
+    if(dmaCount && halSpiDmaDone()) {
 
-	    // set data/command pin (p3.7)
-		P3->OUT |= LCD_DC;
+        run = &dmaQueue[dmaHead];
 
-	} else {
-		// else clear data/command pin (p3.7)
-	    P3->OUT &= ~LCD_DC;
+        // move on to the next pass of this run, or the next run
+        dmaOffset += dmaChunk;
+        if(dmaOffset >= run->length) {
+            dmaOffset = 0;
+            if(--run->repeat <= 0) {
+                dmaHead = (dmaHead + 1) % DMA_QUEUE_SIZE;
+                dmaCount--;
+            }
+        }
 
-	}
+        if(dmaCount) {
+            dmaStart();
+        } else if(dmaCallback) {
+            dmaCallback();
+        }
+    }
+
+    halIrqRestore(state);
+}
 
-    // Transmit byte
-	EUSCI_B0_SPI->TXBUF = byte;
+///////////////////////////////////////////////////////////////////////
+// lcdDmaQueue - Queues a run of bytes to be sent to the LCD by the DMA
+//               controller.  The transfer starts straight away if the
+//               DMA is idle and the function returns without waiting for
+//               it, so the data must stay valid until the queue drains.
+//               If the queue is full this waits for a free slot.
+// Arguments: data - bytes to be sent
+//            length - number of bytes in data
+//            repeat - number of times data is sent back to back (>= 1)
+//            isData - true if bytes are data, false if they are commands
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdDmaQueue(const unsigned char *data, int length, int repeat, int isData)
+{
+    unsigned long state;
+    dmaRun *run;
+
+    if(length <= 0 || repeat <= 0) {
+        return;
+    }
+
+    // wait for a free slot
+    while(dmaCount >= DMA_QUEUE_SIZE) {
+        dmaPoll();
+    }
+
+    state = halIrqSave();
+
+    run = &dmaQueue[(dmaHead + dmaCount) % DMA_QUEUE_SIZE];
+    run->data = data;
+    run->length = length;
+    run->repeat = repeat;
+    run->isData = isData;
+
+    // start the DMA if it was idle
+    if(dmaCount++ == 0) {
+        dmaOffset = 0;
+        dmaStart();
+    }
 
+    halIrqRestore(state);
+}
+
+///////////////////////////////////////////////////////////////////////
+// lcdDmaOnComplete - Sets a function to be called every time the DMA
+//                    queue drains.  It may be called from the DMA
+//                    interrupt, so it must be short.
+// Arguments: callback - function to call, or 0 for none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdDmaOnComplete(void (*callback)(void))
+{
+    dmaCallback = callback;
+}
+
+///////////////////////////////////////////////////////////////////////
+// lcdDmaBusy - Checks if the DMA is still sending queued data
+// Arguments: none
+// Return Value: true if the DMA queue has not drained yet
+///////////////////////////////////////////////////////////////////////
+int lcdDmaBusy(void)
+{
+    dmaPoll();
+    return dmaCount != 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// lcdDmaWait - Waits until all data queued for the DMA has been sent.
+//              Safe to call from an interrupt, the queue is advanced
+//              by polling if the DMA interrupt cannot run.
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdDmaWait(void)
+{
+    while(dmaCount) {
+        dmaPoll();
+    }
 }
@@ -7,6 +7,17 @@
 #ifndef LCD_H_
 #define LCD_H_
 
+// Define LCD_FRAMEBUFFER (in the project's predefined symbols) to draw into a copy of
+// the screen in RAM instead of the panel, lcdFlush then sends what was drawn. Uses 32KB.
+// LCD_FRAMEBUFFER_4BPP keeps the copy as 4 bit palette indexes instead, in 8KB: up to
+// 16 colours on screen at once, taken as they are first drawn and freed by lcdClear
+// (past 16, a new colour is drawn as the closest one already in the palette).
+#ifdef LCD_FRAMEBUFFER_4BPP
+#ifndef LCD_FRAMEBUFFER
+#define LCD_FRAMEBUFFER
+#endif
+#endif
+
 // dimensions of the LCD
 #define LCD_MAX_X 127  // x coordinate 0 to 127
 #define LCD_MAX_Y 127  // y coordinate 0 to 127
@@ -33,9 +44,22 @@
 ///////////////////////////////////////////////////////////////////////
 void lcdClear(int colour);
 
+///////////////////////////////////////////////////////////////////////
+// lcdFillRect - Fills a rectangle of the display with a single colour.
+//               The rectangle is clipped to the display, so it may be
+//               partly (or completely) off screen.
+// Arguments: x0, y0 - bottom left corner of the rectangle
+//            x1, y1 - top right corner of the rectangle (inclusive)
+//            colour - A 16 bit value to represent the RGB colour to
+//                     fill the rectangle with
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdFillRect(int x0, int y0, int x1, int y1, int colour);
+
 ///////////////////////////////////////////////////////////////////////
 // lcdInit - Initializes ports, SPI settings and LCD.
-//           This function assumes CPU clock is less than 15MHz.
+//           halInit must have set up the clocks first, the SPI runs
+//           from SMCLK and stays under CLOCK_SPI_MAX (15MHz).
 // Arguments: none
 // Return Value: none
 ///////////////////////////////////////////////////////////////////////
@@ -52,4 +76,123 @@ void lcdInit();
 ///////////////////////////////////////////////////////////////////////
 void lcdSetPixel(int x, int y, int colour);
 
+///////////////////////////////////////////////////////////////////////
+// lcdSetWindow - Sets the address window that the following calls to
+//                lcdPushPixels stream into.  Pixels are streamed row by
+//                row from y0 up to y1, and each row runs from x1 down to
+//                x0 (the x axis of the display is mirrored).
+//                The window may be partly off screen, pixels falling
+//                outside of the display are dropped by lcdPushPixels.
+// Arguments: x0, y0 - bottom left corner of the window
+//            x1, y1 - top right corner of the window (inclusive)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdSetWindow(int x0, int y0, int x1, int y1);
+
+///////////////////////////////////////////////////////////////////////
+// lcdPushPixels - Streams a run of pixels of the same colour into the
+//                 window set by lcdSetWindow
+// Arguments: colour - A 16 bit value to represent the RGB colour of
+//                     the run
+//            count - number of pixels in the run
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdPushPixels(int colour, int count);
+
+///////////////////////////////////////////////////////////////////////
+// lcdFlush - Sends the parts of a rectangle drawn since they were last
+//            sent to the panel.  Each band of drawn rows goes out as one
+//            window and one RAMWR burst, queued for the DMA.  Does
+//            nothing unless built with LCD_FRAMEBUFFER, drawing then
+//            goes straight to the panel.
+// Arguments: x0, y0 - bottom left corner of the rectangle
+//            x1, y1 - top right corner of the rectangle (inclusive)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdFlush(int x0, int y0, int x1, int y1);
+
+///////////////////////////////////////////////////////////////////////
+// lcdScrollArea - Sets the rows of the screen that lcdScroll moves,
+//                 the rows below and above stay where they are.  The
+//                 area starts out unmoved, anything scrolled before
+//                 must be drawn again.  Does nothing when built with
+//                 LCD_FRAMEBUFFER.
+// Arguments: y0 - bottom row of the area
+//            y1 - top row of the area (inclusive), below y0 for none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdScrollArea(int y0, int y1);
+
+///////////////////////////////////////////////////////////////////////
+// lcdScroll - Moves everything in the scroll area down, by changing
+//             the row of panel memory the panel shows first rather
+//             than sending the pixels again.  Rows leaving the bottom
+//             of the area come back in at its top, until drawn over.
+//             Drawing is still done in screen rows, the driver sends
+//             each row to wherever the area keeps it.  lcdClear moves
+//             the area back.
+// Arguments: dy - rows to move down (negative moves up)
+// Return Value: true if scrolled, false if there is no scroll area or
+//               the driver is built with LCD_FRAMEBUFFER, the moved
+//               pixels must then be drawn instead
+///////////////////////////////////////////////////////////////////////
+int lcdScroll(int dy);
+
+///////////////////////////////////////////////////////////////////////
+// lcdPartial - Shows only some rows of the screen (partial mode), the
+//              panel blanks the rest and stops refreshing them, which
+//              saves power.  Panel memory outside the rows keeps
+//              what was drawn there.
+// Arguments: y0 - bottom row shown
+//            y1 - top row shown (inclusive)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdPartial(int y0, int y1);
+
+///////////////////////////////////////////////////////////////////////
+// lcdNormal - Shows the whole screen again after lcdPartial
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdNormal(void);
+
+///////////////////////////////////////////////////////////////////////
+// lcdDmaQueue - Queues a run of bytes to be sent to the LCD by the DMA
+//               controller.  The transfer starts straight away if the
+//               DMA is idle and the function returns without waiting for
+//               it, so the data must stay valid until the queue drains.
+//               If the queue is full this waits for a free slot.
+// Arguments: data - bytes to be sent
+//            length - number of bytes in data
+//            repeat - number of times data is sent back to back (>= 1)
+//            isData - true if bytes are data, false if they are commands
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdDmaQueue(const unsigned char *data, int length, int repeat, int isData);
+
+///////////////////////////////////////////////////////////////////////
+// lcdDmaOnComplete - Sets a function to be called every time the DMA
+//                    queue drains.  It may be called from the DMA
+//                    interrupt, so it must be short.
+// Arguments: callback - function to call, or 0 for none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdDmaOnComplete(void (*callback)(void));
+
+///////////////////////////////////////////////////////////////////////
+// lcdDmaBusy - Checks if the DMA is still sending queued data
+// Arguments: none
+// Return Value: true if the DMA queue has not drained yet
+///////////////////////////////////////////////////////////////////////
+int lcdDmaBusy(void);
+
+///////////////////////////////////////////////////////////////////////
+// lcdDmaWait - Waits until all data queued for the DMA has been sent.
+//              Safe to call from an interrupt, the queue is advanced
+//              by polling if the DMA interrupt cannot run.
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void lcdDmaWait(void);
+
 #endif /* LCD_H_ */
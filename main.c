@@ -10,89 +10,127 @@
  * S1 will pause the game                                               *
  * S2 will restart the game                                             *
  *                                                                      *
+ * The seed, joystick readings and button presses can be recorded and   *
+ * played back tick for tick, see replay.h                              *
+ *                                                                      *
  ***********************************************************************/
 
 
-#include "msp.h"
+#include "hal.h"
 #include "lcd.h"
 #include "adc.h"
 #include "i2c.h"
 #include "gamefunctions.h"
-#include <math.h>
-#include <stdlib.h>
+#include "game.h"
+#include "probe.h"
+#include "replay.h"
+#include "prng.h"
 
-#define JS_X            BIT0                //  Joystick X input bit P6.0
-#define JS_X_AIN        15                  //  Joystick X analog input 15
+#define JS_X_AIN        15                  //  Joystick X analog input 15 (P6.0)
 
-#define S1              BIT1                //  Define S1 button bit (P5.1)
-#define S1_NVIC         PORT5_IRQn          //  Define S1 NVIC
-#define S1_ACTIVE       !(P5->IN&S1)        //  Define S1 button active
+#define JS_DEAD_ZONE    256                 //  ADC counts either side of the rest reading that keep the pedal centred
+#define JS_REST_RANGE   2048                //  Furthest the rest reading may be from JS_CENTRE, a joystick pushed at power up is not taken as rest
+#define JS_CURVE        jsCurveFine         //  Response curve of the pedal, 0 for linear
 
-#define S2              BIT5                //  Define S2 button bit (P3.5)
-#define S2_NVIC         PORT3_IRQn          //  Define S2 NVIC
-#define S2_ACTIVE       !(P3->IN&S2)        //  Define S2 button active
+#define SEED_SAMPLES    16                  //  Joystick readings mixed into the seed, one per ADC conversion
+#define SEED_STREAM     0                   //  Stream of the game's numbers (prngSeed)
 
-// Dimensions and measurements
+#define S1_ACTIVE       halButtonDown(HAL_BUTTON_S1)    //  Define S1 button active
+#define S2_ACTIVE       halButtonDown(HAL_BUTTON_S2)    //  Define S2 button active
 
-#define BALL_Y_SPAWN        (129+BALL_RADIUS)       // The Y value the ball spawns
-#define BALL_Y_BOTTOM       (LCD_MIN-BALL_RADIUS)   // The lowest Y value the ball drops
-#define BALL_Y_DROP         7                       // Amount of pixels it drops per increment
-#define PEDAL_Y_HIT         -4                      // Pixel as to which to see where ball is (x-wise) to see if hit or miss)
+// Timings
 
-#define BALL_X_START_RANGE  (92-BALL_RADIUS)        // This gets multiplied by random
-#define BALL_X_START_MIN    (18+BALL_RADIUS)        // Lowest value ballX can START
+#define MAX_CATCHUP     4                   // Most ticks simulated in one frame, the rest are dropped
 
-#define BALL_X_ANGLE        5                       // Different angles it can go
-#define BALL_X_DIRECTIONS   2                       // 2 directions
-#define BALL_X_LEFT         -1                      // Ball is going left
+// Global variables
 
-// States
+gameContext game;                   // The game being played, only touched by the main loop
+volatile int ticksPending;          // Ticks posted by the Timer_A0 interrupt, not yet simulated
+volatile int s1Pressed;             // S1 pressed, posted by its interrupt for the main loop
+volatile int s2Pressed;             // S2 pressed, posted by its interrupt for the main loop
+unsigned long frameCount;           // Frames rendered by the main loop
+unsigned long ticksDropped;         // Ticks dropped because the main loop fell too far behind
+unsigned long ticksSimulated;       // Ticks simulated since reset, the time base of replays
 
-#define GAME_ON         1                   //  Meaning game continue
-#define GAME_OFF        0                   //  Meaning game end
 
-#define START_LEVEL     0                   // Start level
-#define END_LEVEL       4                   // End level
+/////////////////////////////////////////////////////
+//  takeTicks - Takes the ticks posted by the Timer_A0 interrupt since the last call
+//  Arguments: none
+//  Return value: number of ticks to simulate
+/////////////////////////////////////////////////////
+int takeTicks();
 
-#define HITS_PER_LEVEL  5                  // Amount of hits before level decrements
 
+/////////////////////////////////////////////////////
+//  tickPosted - Void - Timer_A0 tick handler, posts a tick for the main loop
+//  Arguments: none
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void tickPosted();
 
-// Timings
 
-#define MS_PERIOD       3000                // Cycles per 1 ms
+/////////////////////////////////////////////////////
+//  buttonPressed - Void - S1/S2 button handler, posts a press for the main loop
+//  Arguments: button - HAL_BUTTON_S1 or HAL_BUTTON_S2
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void buttonPressed(int button);
+
 
-#define DROP_INTERVAL   40000               // Period for ball drop timer (6.25s)
-#define DROP_SUBTRACT   8000                // Subtract this, multiplied by level, from period
+/////////////////////////////////////////////////////
+//  handleButtons - Void - debounces and acts on button presses posted by the button interrupts
+//  Arguments: none
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void handleButtons();
+
+
+/////////////////////////////////////////////////////
+//  togglePause - Void - pauses or resumes the game
+//  Arguments: none
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void togglePause();
 
-// Global variables
 
-int ballY;                  // Y value for center of ball
-int ballX;                  // X value for center of ball
-signed int ballX_AngleMax;  // int for keeping track of angle of ball
-int ballX_AngleCount;       // counter that keeps track of if the ball should move
-int ballX_Direction;        // Keeps track whether ball is angling right or left or straight
-volatile int pedalX;        // Stores x value of Joystick, converted into LCD, for the center of the pedal
-volatile int pedalX_prev;   // Stores old x value of Joystick, to compare and erase pedal if needed
-int gameState;              // Determines whether game is still on
-int hitsCounter;            // counter that keeps track of how many hits
-int level;                  // counter that keeps track of level - starts at 0, ends at 4, increments every 10 hits
-int timerCCR;               // value of timer that will get divided each level change
+/////////////////////////////////////////////////////
+//  startGame - Void - (re)initializes the game
+//  Arguments: none
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void startGame();
+
+
+/////////////////////////////////////////////////////
+//  readSeed - Builds a seed out of everything that changes from one power up to the next
+//  Arguments: restX - set to the average of the joystick X readings taken
+//  Return value: seed for the game's numbers
+/////////////////////////////////////////////////////
+int readSeed(int *restX);
+
+
+/////////////////////////////////////////////////////
+//  calibrateJoystick - Void - sets the pedal's calibration from the joystick at rest
+//  Arguments: restX - joystick X reading at rest
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void calibrateJoystick(int restX);
 
 
 /////////////////////////////////////////////////////
-//  initGame - Void - (re)initializes all game parameters
+//  replayGame - Void - plays back the log of replay.c, one frame per tick
 //  Arguments: none
 //  Return value: none allowed
 /////////////////////////////////////////////////////
-void initGame();
+void replayGame();
 
 
 /////////////////////////////////////////////////////
-//  ballSpawn - Void - respawns the ball at the top of the screen
+//  renderFrame - Void - renders one frame of a replay and passes it to halFrameDone
 //  Arguments: none
 //  Return value: none allowed
 /////////////////////////////////////////////////////
-void ballSpawn();
+void renderFrame();
 
 
 /**
@@ -100,247 +138,402 @@ void ballSpawn();
  */
 void main(void)
 {
-	WDT_A->CTL = WDT_A_CTL_PW | WDT_A_CTL_HOLD;		// stop watchdog timer
+    int seed;   // Seed of the game's numbers, read from the sensors
+    int restX;  // Joystick X reading at rest, the centre of the pedal's calibration
+
+    halInit();      // stop watchdog timer, set up the clocks
+
+    // Start the cycle counter of the probes (nothing unless PROBE_ENABLE)
+    probeInit();
 
     // Initalize LCD
     lcdInit();
 
+    // Build ball sprite
+    ballSpriteInit();
+
     // Initialize i2C
     i2cInit();
 
-    // Initalize optical sensor
-    i2cWrite(OPT3001_SLAVE_ADDRESS, OPT3001_CONFIG_REG, OPT3001_CONFIG_100);
-
-    // Initialize random
-    srand(i2cRead(OPT3001_SLAVE_ADDRESS, OPT3001_RESULT_REG));
-
-    // Set bits for joystick X (P6.0)
-    P6->SEL1 |= JS_X;
-    P6->SEL0 |= JS_X;
-
-    // Setup S1 Button P5.1 (Active low, normally closed)
-    P5->DIR &= ~S1;
-
-    //Setup S1 Button Interrupt (Falling edge)
-    P5->IE |= S1;
-    P5->IES |= S1;
+    // Seed the game's numbers from the sensors, the joystick noise and the timing of both
+    seed = readSeed(&restX);
 
-    // Setup S2 Button P3.5 (Active low, normally closed)
-    P3->DIR &= ~S2;
+    // Sample joystick X-axis (AIN 15) continuously in the background
+    adcStartContinuous(JS_X_AIN);
 
-    // Setup S2 Button Interrupt (Falling edge)
-    P3->IE |= S2;
-    P3->IES |= S2;
+    // A recording starts with the seed and the rest reading, a replay takes the recorded ones
+    seed = replayStart(seed, &restX);
+    prngSeed(&game.rng, seed, SEED_STREAM);
 
-    // In ADC14CTL registers:
-    ADC14->CTL0 &= ~ADC14_CTL0_ENC; //Clear ADC14 Conversion bit
-    ADC14->CTL0 |= ADC14_CTL0_ON;   //Turn ADC14 on
-    ADC14->CTL0 |= ADC14_CTL0_SHP;  //Turn ADC14 Sample and hold pulse mode
-    ADC14->CTL0 |= ADC14_CTL0_ENC;  //Set ADC14 Conversion bit to enable
+    // Dead zone, centre and response curve of the pedal
+    calibrateJoystick(restX);
 
-    // Timer for dropping the ball, /16, up mode, with period of 160ms
-    TIMER_A0->CTL = TIMER_A_CTL_SSEL__SMCLK | TIMER_A_CTL_ID__8 | TIMER_A_CTL_MC__UP | TIMER_A_CTL_IE;
-    TIMER_A0->EX0 = TIMER_A_EX0_IDEX__2;
-    TIMER_A0->CCR[0] = DROP_INTERVAL-1;
+    // Setup S1 Button P5.1 and S2 Button P3.5 (Active low, interrupt on falling edge)
+    halButtonsInit(buttonPressed);
 
-    // Enable NVIC for interrupts
-    NVIC_EnableIRQ(S1_NVIC);    // S1 Button NVIC
-    NVIC_EnableIRQ(S2_NVIC);    // S2 Button NVIC
-    NVIC_EnableIRQ(TA0_N_IRQn); // Timer_A0 NVIC
+    // Timer for dropping the ball, 30 ticks a second (DROP_INTERVAL at HAL_TICK_HZ), up mode
+    halTickInit(DROP_INTERVAL, tickPosted);
 
     // Enable global interrupt enable
-    _enable_interrupts();
+    halEnableInterrupts();
 
     // Initialize all game parameters
-    initGame();
+    startGame();
 
+    // Replays are played from the log instead of the loop below
+    if(replayMode == REPLAY_MODE_PLAY) {
+        replayGame();
+    }
 
-    // Loop forever
+    // Loop forever: input -> update -> render
     while(1) {
 
+        int ticks;      // Ticks to simulate this frame
+        int joystick;   // Filtered joystick X reading
+
+        // Frame timings are kept per level
+        PROBE_GROUP(game.level);
+        PROBE_START(PROBE_FRAME);
+
+        // Act on button presses
+        PROBE_START(PROBE_INPUT);
+        handleButtons();
+
         //Make sure game is on!
-        if(gameState == GAME_ON) {
+        if(game.gameState == GAME_ON) {
+
+            // Input: filtered joystick X converted to LDC value
+            joystick = adcLatest();
+            game.pedalX = jsLcdConv(joystick);
+            PROBE_STOP(PROBE_INPUT);
+
+            // Update: one fixed step per timer tick, catching up if the last frame took longer than a tick
+            ticks = takeTicks();
+            if(ticks > MAX_CATCHUP) {
+                ticksDropped += ticks - MAX_CATCHUP;
+                ticks = MAX_CATCHUP;
+            } // end if: too far behind
+            // Only the reading the ticks are simulated with is part of a recording
+            if(ticks > 0) {
+                replayRecord(ticksSimulated, REPLAY_JOYSTICK, joystick);
+            } // end if: ticks to simulate
+            PROBE_START(PROBE_UPDATE);
+            while(ticks-- > 0 && game.gameState == GAME_ON) {
+                gameUpdate(&game);
+                ticksSimulated++;
+            } // end while: catch up, up to the tick that ends the game
+            PROBE_STOP(PROBE_UPDATE);
 
-            adcInit(JS_X_AIN);                 // Select input, Joystick X-axis (AIN 15)
-            pedalX = jsLcdConv(adcSample());   // Joystick X converted to LDC value
+        } else {
 
-            //If there is a change in the x value of the joystick, write a new pedal value
-            if(pedalX!=pedalX_prev) {
+            PROBE_STOP(PROBE_INPUT);
 
-                writePedal(pedalX, pedalX_prev);    // Write new pedal on screen
-                pedalX_prev = pedalX;               // Update the value of pedalX
+            // Ticks while paused or between games are not simulated
+            takeTicks();
 
-            } // end if: new ADC value for pedalX
         } // end if: gameState = ON
+
+        // Render: repaint what changed (also draws the end screen once the game goes off)
+        PROBE_START(PROBE_RENDER);
+        gameRender(&game);
+        lcdFlush(0, 0, LCD_MAX_X, LCD_MAX_Y);
+        PROBE_STOP(PROBE_RENDER);
+        frameCount++;
+        halFrameDone();
+
+        PROBE_STOP(PROBE_FRAME);
+
     } // end while: Loop forever
 } // end Main
 
 
-////////////////////////////////////////////////////////////
-//  Timer_A0 TAIFG ISR - Takes care of ball dropping - Also keeps score, ranges from 213ms at level 0 -> 56ms at level 4
-//  Arguments: None allowed
-//  Return values: None
-////////////////////////////////////////////////////////////
-void TA0_N_IRQHandler(void) {
+/////////////////////////////////////////////////////
+//  tickPosted - Void - Timer_A0 tick handler, posts a tick for the main loop
+//  Fixed at 30 ticks a second (about 33ms) at every level, DROP_INTERVAL counts at HAL_TICK_HZ
+//  Arguments: none
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void tickPosted() {
+
+    PROBE_START(PROBE_TICK);
+
+    //Post tick, the ball is dropped by the main loop
+    ticksPending++;
+
+    PROBE_STOP(PROBE_TICK);
+
+} // end tickPosted
+
+
+/////////////////////////////////////////////////////
+//  buttonPressed - Void - S1/S2 button handler, posts a press for the main loop
+//  Arguments: button - HAL_BUTTON_S1 or HAL_BUTTON_S2
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void buttonPressed(int button) {
+
+    PROBE_START(PROBE_BUTTON);
+
+    //Post press, debounced and handled by the main loop
+    if(button == HAL_BUTTON_S1) {
+        s1Pressed = 1;
+    } else {
+        s2Pressed = 1;
+    } // end if: S1
 
-    //clear Timer flag
-    TIMER_A0->CTL &= ~TIMER_A_CTL_IFG;
+    PROBE_STOP(PROBE_BUTTON);
 
-    //Make sure game is on!
-    if(gameState == GAME_ON) {
+} // end buttonPressed
 
-        //Erase ball
-        writeBall(ballX, ballY, ERASE);
 
-        //Decrement BALL Y value by 5
-        ballY -= BALL_Y_DROP;
+/////////////////////////////////////////////////////
+//  takeTicks - Takes the ticks posted by the Timer_A0 interrupt since the last call
+//  Arguments: none
+//  Return value: number of ticks to simulate
+/////////////////////////////////////////////////////
+int takeTicks() {
 
-        //Increment ball angle counter
-        ballX_AngleCount++;
+    int ticks;              // Ticks posted since the last call
+    unsigned long state;    // Interrupt state to restore
 
-        //If ballX angle counter has reached its max count
-        if(ballX_AngleCount>ballX_AngleMax) {
-            ballX += ballX_Direction; // Increment ballX either to the left, nothing, or right
-            ballX_AngleCount=0; // Reset angle counter
-        } // end if: ballX angle counter reaches max
+    // Read and clear without the interrupt posting in between
+    state = halIrqSave();
+    ticks = ticksPending;
+    ticksPending = 0;
+    halIrqRestore(state);
 
-        //If ball reaches the height at which the pedal is ...
-        if((ballY-BALL_RADIUS)==PEDAL_Y_HIT) {
+    return ticks;
 
-            //To make things easier, combine the values of the ball and pedal width
-            int ballRange = BALL_RADIUS + PEDAL_WIDTH;
+} // end takeTicks
 
-            //Hit collision detector:
-            //Check to see if ball is within the range of x values it should be
-            if(pedalX<=(ballX+ballRange) && pedalX>=(ballX-ballRange)) {
 
-                //Respawn ball at top of screen with diff parameters
-                ballSpawn();
+/////////////////////////////////////////////////////
+//  handleButtons - Void - debounces and acts on button presses posted by the button interrupts
+//  Arguments: none
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void handleButtons() {
 
-                //increment hits counter, if it reaches to 10, reset hits counter and increment level
-                hitsCounter++;
-                if(hitsCounter>=HITS_PER_LEVEL) {
+    //S1 pauses or resumes the game
+    if(s1Pressed) {
 
-                    hitsCounter=0; //reset hits counter
-                    level++; // increment level
+        //Debounce delay 10ms
+        msDelay(DEBOUNCE);
+        s1Pressed = 0;
 
-                    timerCCR = timerCCR * 10 / 14; // new timer value is divided by 1.4 from the previous level
-                    TIMER_A0->CCR[0] = timerCCR-1; //update timer to reflect level change
+        //If S1 button is still pressed, toggle the game
+        if(S1_ACTIVE) {
 
-                    //If level max is overcome, you have won the game - so clear LCD and turn game off
-                    if(level>END_LEVEL) {
-                        lcdClear(GREEN);
-                        gameState=GAME_OFF;
-                    } // end if: end game
-                } // end if: hits Counter reset
-            } // end if: hit collision detector
-        } // end if:
+            replayRecord(ticksSimulated, REPLAY_S1, 0);
+            togglePause();
 
-        //If ball reaches bottom, game over
-        if(ballY<=BALL_Y_BOTTOM) {
+        } // End if: S1_ACTIVE
+    } // End if: s1Pressed
 
-            //Clear screen and game, game has been lost
-            lcdClear(RED);
-            gameState=GAME_OFF;
+    //S2 restarts the game
+    if(s2Pressed) {
 
-        } // end if: ball reaches bottom
+        //Debounce delay 10ms
+        msDelay(DEBOUNCE);
+        s2Pressed = 0;
 
-        //Write new ball
-        writeBall(ballX, ballY, WRITE);
+        //If S2 button is still pressed, restart
+        if(S2_ACTIVE) {
 
-    } // End if: if game is on
-} // end ISR for Timer_A0
+            //Reinitialize game values
+            replayRecord(ticksSimulated, REPLAY_S2, 0);
+            startGame();
+
+        } // End if: S2_ACTIVE
+    } // End if: s2Pressed
+
+} // end handleButtons
 
 
 /////////////////////////////////////////////////////
-//  S1 Button IRS -- Pause/Restart
-//  Arguments: None allowed
-//  Return value: None
+//  togglePause - Void - pauses or resumes the game, nothing once the game is won or lost
+//  While paused only the HUD is shown (partial mode), the panel stops refreshing the
+//  play field and keeps what was drawn there for when the game resumes
+//  Arguments: none
+//  Return value: none allowed
 /////////////////////////////////////////////////////
-void PORT5_IRQHandler(void) {
+void togglePause() {
 
-    //Debounce delay 10ms
-    msDelay(DEBOUNCE);
+    //If game is paused, start it back up - if it is on, pause it. The end screens stay as they are
+    if(game.gameState==GAME_PAUSED) {
 
-    //Clear S1 Button IFG (P5.1)
-    P5->IFG &= ~S1;
+        game.gameState=GAME_ON;
+        lcdNormal();
 
-    //If S1 button is pressed, clear the screen
-    if(S1_ACTIVE) {
+    } else if(game.gameState==GAME_ON) {
 
-        //If game is paused (GAME_OFF), start it back up - else, pause it
-        if(gameState==GAME_OFF) {
+        game.gameState=GAME_PAUSED;
+        lcdPartial(HUD_Y0, LCD_MAX);
 
-            gameState=GAME_ON;
+    } // end if: gameState==GAME_PAUSED
 
-        } else {
+} // end togglePause
 
-            gameState=GAME_OFF;
 
-        } // end if: gameState==GAME_OFF
+/////////////////////////////////////////////////////
+//  startGame - Void - (re)initializes the game
+//  Arguments: none
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void startGame() {
+
+    int joystick = adcLatest();             // Filtered joystick X reading
 
-    } // End if: S1_ACTIVE
+    gameInit(&game);                        // Reset all game parameters
+    lcdNormal();                            // Whole screen, S2 may come while paused
+    takeTicks();                            // Ticks of the old game are not simulated
+    game.pedalX = jsLcdConv(joystick);      // Joystick X converted to LDC value
+    replayRecord(ticksSimulated, REPLAY_JOYSTICK, joystick);
 
-} // End S1 IRS
+} // end startGame
 
 
 /////////////////////////////////////////////////////
-//  S2 Button IRS -- restart game
-//  Arguments: None allowed
-//  Return value: None
+//  readSeed - Builds a seed out of everything that changes from one power up to the next
+//  The light level changes little in a room, so the sensors are only part of it: the noise in
+//  the low bits of the thermopile voltage and of the joystick, and the cycles each reading took
+//  The joystick is read one raw conversion at a time, before continuous mode starts: the moving
+//  average of adcLatest would smooth the noise away. Their average is the joystick at rest
+//  Arguments: restX - set to the average of the joystick X readings taken
+//  Return value: seed for the game's numbers
 /////////////////////////////////////////////////////
-void PORT3_IRQHandler(void) {
+int readSeed(int *restX) {
+
+    unsigned long seed = PRNG_MIX_BASIS;   // Hash of every reading so far
+    int reading;                            // One sensor reading
+    int sample;                             // Joystick reading being taken
+    long sum = 0;                           // Sum of the joystick readings
+
+    //Optical sensor, if it answers (the first result may be from before the configuration)
+    if(i2cWrite(OPT3001_SLAVE_ADDRESS, OPT3001_CONFIG_REG, OPT3001_CONFIG_100) == I2C_OK
+       && i2cRead(OPT3001_SLAVE_ADDRESS, OPT3001_RESULT_REG, &reading) == I2C_OK) {
+        seed = prngMix(seed, reading);
+    } // end if: OPT3001
+    seed = prngMix(seed, halTimerJitter());
+
+    //Temperature sensor, if it answers: the thermopile voltage is the noisy part
+    if(i2cRead(TMP006_SLAVE_ADDRESS, TMP006_VOLTAGE_REG, &reading) == I2C_OK) {
+        seed = prngMix(seed, reading);
+    } // end if: TMP006 voltage
+    if(i2cRead(TMP006_SLAVE_ADDRESS, TMP006_TEMPERATURE_REG, &reading) == I2C_OK) {
+        seed = prngMix(seed, reading);
+    } // end if: TMP006 temperature
+    seed = prngMix(seed, halTimerJitter());
+
+    //Joystick at rest, a new raw conversion each time
+    adcInit(JS_X_AIN);
+    for(sample=0; sample<SEED_SAMPLES; sample++) {
+        halDelayUs(1000000 / ADC_SAMPLE_HZ);
+        reading = adcSample();
+        sum += reading;
+        seed = prngMix(seed, reading);
+        seed = prngMix(seed, halTimerJitter());
+    } // end for: samples
+    *restX = (int)(sum / SEED_SAMPLES);
+
+    return (int)seed;
+
+} // end readSeed
 
-    //Debounce delay 10ms
-    msDelay(DEBOUNCE);
 
-    //Clear S2 Button IFG (P3.5)
-    P3->IFG &= ~S2;
+/////////////////////////////////////////////////////
+//  calibrateJoystick - Void - sets the pedal's calibration from the joystick at rest
+//  The rest reading becomes the centre unless it is too far off JS_CENTRE to be a joystick
+//  left alone, the range is JS_MIN to JS_MAX either way
+//  Arguments: restX - joystick X reading at rest
+//  Return value: none allowed
+/////////////////////////////////////////////////////
+void calibrateJoystick(int restX) {
 
-    //If S2 button is pressed, transmit the string "S2 pressed"
-    if(S2_ACTIVE) {
+    jsCalibration calibration = { JS_MIN, JS_MAX, JS_CENTRE, JS_DEAD_ZONE, JS_CURVE };
 
-        //Reinitialize game values
-        initGame();
+    //Pushed at power up: keep the centre of the range
+    if(restX >= JS_CENTRE-JS_REST_RANGE && restX <= JS_CENTRE+JS_REST_RANGE) {
+        calibration.adcCentre = restX;
+    } // end if: rest reading in range
 
-    } // End if: S2_ACTIVE
+    jsCalibrate(&calibration);
 
-} // End S2 IRS
+} // end calibrateJoystick
 
 
 /////////////////////////////////////////////////////
-//  initGame - Void - (re)initializes all game parameters
+//  replayGame - Void - plays back the log of replay.c, one frame per tick
+//  The ticks are simulated and rendered one at a time rather than in time with the
+//  timer, so the frames only depend on the log and not on how long they take to draw
 //  Arguments: none
 //  Return value: none allowed
 /////////////////////////////////////////////////////
-void initGame() {
+void replayGame() {
+
+    replayEvent event;      // Next input of the log
+    int joystick = 0;       // Joystick reading of the last input, the log starts from 0
+
+    // The game was started with the live joystick, the log's reading is used instead
+    game.pedalX = jsLcdConv(joystick);
+
+    while(replayNext(&event)) {
 
-    lcdClear(BG_COLOR);                 // Set LCD to CYAN background
-    timerCCR = DROP_INTERVAL-1;         // value of timer that will get divided each level change
-    TIMER_A0->CCR[0] = DROP_INTERVAL-1; // Resets the timer/rate ball falls down
-    hitsCounter=0;                      // counter that keeps track of how many hits
-    level=0;                            // counter that keeps track of level - starts at 0, ends at 4, increments every 10 hits
-    ballSpawn();                        // Initialize the ball spawn
-    gameState = GAME_ON;                // turn state of game as on
+        // Simulate up to the tick the input came before (none while paused or over)
+        while(ticksSimulated < event.tick && game.gameState == GAME_ON) {
+            gameUpdate(&game);
+            ticksSimulated++;
+            renderFrame();
+        } // end while: ticks before the input
 
-    pedalX = jsLcdConv(adcSample());    // Joystick X converted to LDC value
-    writePedal(pedalX, pedalX_prev);    // Write new pedal on screen
-    pedalX_prev = pedalX;               // Update the value of pedalX
+        //Act on the input like the main loop did when it was recorded
+        if(event.type == REPLAY_JOYSTICK) {
+
+            joystick = event.value;
+            game.pedalX = jsLcdConv(joystick);
+
+        } else if(event.type == REPLAY_S1) {
+
+            togglePause();
+
+        } else if(event.type == REPLAY_S2) {
+
+            //The joystick reading is only logged if it changed
+            gameInit(&game);
+            lcdNormal();                    // Whole screen, S2 may come while paused
+            game.pedalX = jsLcdConv(joystick);
+
+        } else {
+
+            break;
+
+        } // end if: event.type
+
+        renderFrame();
+
+    } // end while: events of the log
+
+    // Nothing more to play, the last frame stays on the screen (the simulator stops here)
+    replayMode = REPLAY_MODE_OFF;
+    renderFrame();
+    while(1) {
+        halDelayMs(DEBOUNCE);
+    } // end while: forever
 
-} // end initGame
+} // end replayGame
 
 
 /////////////////////////////////////////////////////
-//  ballSpawn - Void - respawns the ball at the top of the screen
+//  renderFrame - Void - renders one frame of a replay and passes it to halFrameDone
 //  Arguments: none
 //  Return value: none allowed
 /////////////////////////////////////////////////////
-void ballSpawn() {
+void renderFrame() {
 
-    ballY = BALL_Y_SPAWN; // Put ball back at top
-    ballX = BALL_X_START_MIN + rand() % BALL_X_START_RANGE; //Randomizes ball x starting location
-    ballX_Direction = BALL_X_LEFT + BALL_X_DIRECTIONS * (rand() % BALL_X_DIRECTIONS); // Randomizes ballx direction (or the swing)
-    ballX_AngleMax = rand() % BALL_X_ANGLE; // Randomizes the angle ballx takes
-    ballX_AngleCount = 0; // reset angle counter
+    gameRender(&game);
+    lcdFlush(0, 0, LCD_MAX_X, LCD_MAX_Y);
+    lcdDmaWait();           // The whole frame is on the screen before it is passed on
+    frameCount++;
+    halFrameDone();
 
-} // end ballSpawn
+} // end renderFrame
@@ -0,0 +1,90 @@
+// Filename: prng.c
+// Description: Seedable pseudo random numbers, see prng.h
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#include "prng.h"
+
+#define PRNG_MULTIPLIER     6364136223846793005ULL  // LCG multiplier of PCG32
+#define PRNG_MASK           0xFFFFFFFFUL            // unsigned long is wider than 32 bits on the host
+
+///////////////////////////////////////////////////////////////////////
+// prngSeed - Starts a stream of numbers
+// Arguments: rng - state to start
+//            seed - where in the sequence to start
+//            stream - which sequence, any number
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void prngSeed(prngState *rng, unsigned long seed, unsigned long stream)
+{
+    rng->state = 0;
+    rng->increment = ((unsigned long long)(stream & PRNG_MASK) << 1) | 1;
+    prngNext(rng);
+    rng->state += seed & PRNG_MASK;
+    prngNext(rng);
+}
+
+///////////////////////////////////////////////////////////////////////
+// prngNext - Takes the next number of a stream
+// Arguments: rng - stream to take it from
+// Return Value: 32 random bits
+///////////////////////////////////////////////////////////////////////
+unsigned long prngNext(prngState *rng)
+{
+    unsigned long long old = rng->state;
+    unsigned long bits;
+    unsigned int rotate;
+
+    rng->state = old * PRNG_MULTIPLIER + rng->increment;
+
+    // xorshift the high bits down, then rotate by the top 5 bits
+    bits = (unsigned long)(((old >> 18) ^ old) >> 27) & PRNG_MASK;
+    rotate = (unsigned int)(old >> 59);
+    return ((bits >> rotate) | (bits << ((32 - rotate) & 31))) & PRNG_MASK;
+}
+
+///////////////////////////////////////////////////////////////////////
+// prngBelow - Takes a number in a range, every number in the range
+//             being equally likely
+// Arguments: rng - stream to take it from
+//            bound - end of the range, 1 or more
+// Return Value: 0 to bound-1
+///////////////////////////////////////////////////////////////////////
+int prngBelow(prngState *rng, int bound)
+{
+    unsigned long long product = (unsigned long long)prngNext(rng) * (unsigned long)bound;
+    unsigned long low = (unsigned long)product & PRNG_MASK;
+    unsigned long threshold;
+
+    // The top 32 bits of the product are the number. 2^32 % bound of the low
+    // values would make some numbers come up once more than the rest, those are
+    // drawn again. Only a low value under bound can be one, so the % is rare.
+    if(low < (unsigned long)bound) {
+        threshold = (0x100000000ULL - (unsigned long)bound) % (unsigned long)bound;
+        while(low < threshold) {
+            product = (unsigned long long)prngNext(rng) * (unsigned long)bound;
+            low = (unsigned long)product & PRNG_MASK;
+        }
+    }
+    return (int)(product >> 32);
+}
+
+///////////////////////////////////////////////////////////////////////
+// prngMix - Folds a value into a hash, to build a seed out of readings
+//           that each only have a few bits that change
+// Arguments: hash - hash so far, PRNG_MIX_BASIS to start
+//            value - reading to fold in
+// Return Value: new hash, 32 bits
+///////////////////////////////////////////////////////////////////////
+unsigned long prngMix(unsigned long hash, unsigned long value)
+{
+    // murmur3 finalizer, every bit of the value reaches every bit of the hash
+    hash = (hash ^ (value & PRNG_MASK)) & PRNG_MASK;
+    hash ^= hash >> 16;
+    hash = (hash * 0x85EBCA6BUL) & PRNG_MASK;
+    hash ^= hash >> 13;
+    hash = (hash * 0xC2B2AE35UL) & PRNG_MASK;
+    hash ^= hash >> 16;
+    return hash;
+}
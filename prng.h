@@ -0,0 +1,58 @@
+// Filename: prng.h
+// Description: Seedable pseudo random numbers (PCG32: a 64 bit LCG, its high bits permuted
+//              into 32 bits of output). All of the state is in a prngState, so every user
+//              has its own stream and nothing is shared like the state behind rand(). Two
+//              states seeded with the same seed but different streams give unrelated numbers.
+//
+//              prngBelow picks a number in a range by multiplying rather than with %, and is
+//              without bias: it only divides in the rare draw that has to be rejected.
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#ifndef PRNG_H_
+#define PRNG_H_
+
+#define PRNG_MIX_BASIS      0x9E3779B9UL    // starting value for prngMix
+
+// State of one stream of numbers
+typedef struct {
+    unsigned long long state;       // LCG state, every value is visited once per 2^64 numbers
+    unsigned long long increment;   // odd, picks the stream
+} prngState;
+
+///////////////////////////////////////////////////////////////////////
+// prngSeed - Starts a stream of numbers
+// Arguments: rng - state to start
+//            seed - where in the sequence to start
+//            stream - which sequence, any number
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void prngSeed(prngState *rng, unsigned long seed, unsigned long stream);
+
+///////////////////////////////////////////////////////////////////////
+// prngNext - Takes the next number of a stream
+// Arguments: rng - stream to take it from
+// Return Value: 32 random bits
+///////////////////////////////////////////////////////////////////////
+unsigned long prngNext(prngState *rng);
+
+///////////////////////////////////////////////////////////////////////
+// prngBelow - Takes a number in a range, every number in the range
+//             being equally likely
+// Arguments: rng - stream to take it from
+//            bound - end of the range, 1 or more
+// Return Value: 0 to bound-1
+///////////////////////////////////////////////////////////////////////
+int prngBelow(prngState *rng, int bound);
+
+///////////////////////////////////////////////////////////////////////
+// prngMix - Folds a value into a hash, to build a seed out of readings
+//           that each only have a few bits that change
+// Arguments: hash - hash so far, PRNG_MIX_BASIS to start
+//            value - reading to fold in
+// Return Value: new hash, 32 bits
+///////////////////////////////////////////////////////////////////////
+unsigned long prngMix(unsigned long hash, unsigned long value);
+
+#endif /* PRNG_H_ */
@@ -0,0 +1,126 @@
+// Filename: probe.c
+// Description: Cycle count probes, see probe.h. Empty unless PROBE_ENABLE is defined.
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#include "probe.h"
+
+#ifdef PROBE_ENABLE
+
+#include "hal.h"
+
+probeStats probeTable[PROBE_GROUPS][PROBE_COUNT];
+
+static int probeCurrent;        // group measurements are added to
+
+static const char *const probeNames[PROBE_COUNT] = {
+    "tick isr",
+    "button isr",
+    "input",
+    "update",
+    "render",
+    "frame",
+};
+
+///////////////////////////////////////////////////////////////////////
+// probeInit - Starts the cycle counter and clears the figures
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void probeInit(void)
+{
+    int group;
+    int probe;
+
+    halCyclesInit();
+    for(group = 0; group < PROBE_GROUPS; group++) {
+        for(probe = 0; probe < PROBE_COUNT; probe++) {
+            probeTable[group][probe].count = 0;
+            probeTable[group][probe].min = ~0UL;
+            probeTable[group][probe].max = 0;
+            probeTable[group][probe].total = 0;
+        }
+    }
+    probeCurrent = 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// probeGroup - Sets the group later measurements are added to
+// Arguments: group - group number, from 0
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void probeGroup(int group)
+{
+    if(group < 0) {
+        group = 0;
+    }
+    probeCurrent = (group < PROBE_GROUPS) ? group : PROBE_GROUPS - 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// probeStart - Marks the start of a measurement
+// Arguments: probe - PROBE_ point
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void probeStart(int probe)
+{
+    // start times are kept in group 0 so a group change mid measurement does not lose them
+    probeTable[0][probe].start = halCycles();
+}
+
+///////////////////////////////////////////////////////////////////////
+// probeStop - Ends a measurement and adds it to the figures of the group
+//             that is current now
+// Arguments: probe - PROBE_ point
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void probeStop(int probe)
+{
+    // unsigned subtraction copes with the counter wrapping
+    unsigned long cycles = (halCycles() - probeTable[0][probe].start) & 0xFFFFFFFFUL;
+    probeStats *stats = &probeTable[probeCurrent][probe];
+
+    stats->count++;
+    stats->total += cycles;
+    if(cycles < stats->min) {
+        stats->min = cycles;
+    }
+    if(cycles > stats->max) {
+        stats->max = cycles;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// probeName - Gets the name of a probe point
+// Arguments: probe - PROBE_ point
+// Return Value: name, for reports
+///////////////////////////////////////////////////////////////////////
+const char *probeName(int probe)
+{
+    return (probe >= 0 && probe < PROBE_COUNT) ? probeNames[probe] : "?";
+}
+
+///////////////////////////////////////////////////////////////////////
+// probeDump - Reports the figures of every probe point that was used
+// Arguments: report - called once per group and probe point, with the
+//                     mean already worked out
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void probeDump(void (*report)(int group, int probe, const probeStats *stats, unsigned long mean))
+{
+    int group;
+    int probe;
+    const probeStats *stats;
+
+    for(group = 0; group < PROBE_GROUPS; group++) {
+        for(probe = 0; probe < PROBE_COUNT; probe++) {
+            stats = &probeTable[group][probe];
+            if(stats->count) {
+                report(group, probe, stats, (unsigned long)(stats->total / stats->count));
+            }
+        }
+    }
+}
+
+#endif /* PROBE_ENABLE */
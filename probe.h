@@ -0,0 +1,100 @@
+// Filename: probe.h
+// Description: Cycle count probes. PROBE_START/PROBE_STOP around a piece of code keep the
+//              min/max/mean cycles it takes, per probe and per group (the game level),
+//              using halCycles (the DWT cycle counter on the board).
+//
+//              Probes are compiled out entirely unless PROBE_ENABLE is defined (add it to
+//              the predefined symbols of the project, or build the simulator with
+//              make PROBE=1). Probes may nest, but a probe must not be started again
+//              before it is stopped, so a probe is used in one context only.
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#ifndef PROBE_H_
+#define PROBE_H_
+
+// Probe points
+#define PROBE_TICK          0       // tick interrupt handler
+#define PROBE_BUTTON        1       // button interrupt handler
+#define PROBE_INPUT         2       // buttons and joystick read by the main loop
+#define PROBE_UPDATE        3       // gameUpdate, all ticks of a frame
+#define PROBE_RENDER        4       // gameRender
+#define PROBE_FRAME         5       // one pass of the main loop
+#define PROBE_COUNT         6
+
+#define PROBE_GROUPS        8       // groups kept apart, group numbers past the last share it
+
+// Cycles taken by one probe point in one group
+typedef struct {
+    unsigned long count;            // times stopped
+    unsigned long min;
+    unsigned long max;
+    unsigned long long total;       // for the mean
+    unsigned long start;            // halCycles at PROBE_START
+} probeStats;
+
+#ifdef PROBE_ENABLE
+
+#define PROBE_START(probe)      probeStart(probe)
+#define PROBE_STOP(probe)       probeStop(probe)
+#define PROBE_GROUP(group)      probeGroup(group)
+
+// Figures of every probe point in every group, for the debugger
+extern probeStats probeTable[PROBE_GROUPS][PROBE_COUNT];
+
+///////////////////////////////////////////////////////////////////////
+// probeInit - Starts the cycle counter and clears the figures
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void probeInit(void);
+
+///////////////////////////////////////////////////////////////////////
+// probeGroup - Sets the group later measurements are added to
+// Arguments: group - group number, from 0
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void probeGroup(int group);
+
+///////////////////////////////////////////////////////////////////////
+// probeStart - Marks the start of a measurement
+// Arguments: probe - PROBE_ point
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void probeStart(int probe);
+
+///////////////////////////////////////////////////////////////////////
+// probeStop - Ends a measurement and adds it to the figures of the group
+//             that is current now
+// Arguments: probe - PROBE_ point
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void probeStop(int probe);
+
+///////////////////////////////////////////////////////////////////////
+// probeName - Gets the name of a probe point
+// Arguments: probe - PROBE_ point
+// Return Value: name, for reports
+///////////////////////////////////////////////////////////////////////
+const char *probeName(int probe);
+
+///////////////////////////////////////////////////////////////////////
+// probeDump - Reports the figures of every probe point that was used
+// Arguments: report - called once per group and probe point, with the
+//                     mean already worked out
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void probeDump(void (*report)(int group, int probe, const probeStats *stats, unsigned long mean));
+
+#else
+
+#define PROBE_START(probe)
+#define PROBE_STOP(probe)
+#define PROBE_GROUP(group)
+#define probeInit()
+#define probeDump(report)
+
+#endif /* PROBE_ENABLE */
+
+#endif /* PROBE_H_ */
@@ -0,0 +1,221 @@
+// Filename: replay.c
+// Description: Recording and replay of a session, see replay.h
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#include "replay.h"
+
+#define REPLAY_HEADER       9       // bytes before the first event
+#define REPLAY_VARINT_MAX   5       // most bytes of a 32 bit varint
+#define REPLAY_TYPE_BITS    2       // type bits below the tick delta
+
+#ifdef REPLAY_LOG_FILE
+#include REPLAY_LOG_FILE            // replayRecorded[] and replayRecorded_len, from xxd -i
+#endif
+
+#if defined(REPLAY_LOG_FILE)
+int replayMode = REPLAY_MODE_PLAY;
+static unsigned char *replayData = replayRecorded;
+static int replaySize = sizeof(replayRecorded);
+int replayLength = sizeof(replayRecorded);
+#elif defined(REPLAY_RECORD_ENABLE)
+unsigned char replayBuffer[REPLAY_SIZE];
+int replayMode = REPLAY_MODE_RECORD;
+static unsigned char *replayData = replayBuffer;
+static int replaySize = REPLAY_SIZE;
+int replayLength;
+#else
+int replayMode = REPLAY_MODE_OFF;
+static unsigned char *replayData;
+static int replaySize;
+int replayLength;
+#endif
+
+static int replayPosition;          // next byte read when playing
+static unsigned long replayTick;    // tick of the last event
+static int replayJoystick;          // joystick reading of the last event
+
+///////////////////////////////////////////////////////////////////////
+// replayPut - Writes a varint at the end of the log
+// Arguments: value - number to write
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void replayPut(unsigned long value)
+{
+    while(value >= 0x80) {
+        replayData[replayLength++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    replayData[replayLength++] = (unsigned char)value;
+}
+
+///////////////////////////////////////////////////////////////////////
+// replayGet - Reads the next varint of the log
+// Arguments: value - where the number is put
+// Return Value: true if it was read, false if the log ended part way
+///////////////////////////////////////////////////////////////////////
+static int replayGet(unsigned long *value)
+{
+    int shift = 0;
+    unsigned char byte;
+
+    *value = 0;
+    do {
+        if(replayPosition >= replayLength || shift > 28) {
+            return 0;
+        }
+        byte = replayData[replayPosition++];
+        *value |= (unsigned long)(byte & 0x7F) << shift;
+        shift += 7;
+    } while(byte & 0x80);
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// replayRecordTo - Starts recording into a buffer
+// Arguments: buffer - where the log is written
+//            size - bytes of buffer, recording stops (with a
+//                   REPLAY_END) once it is full
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void replayRecordTo(unsigned char *buffer, int size)
+{
+    replayMode = REPLAY_MODE_RECORD;
+    replayData = buffer;
+    replaySize = size;
+    replayLength = 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// replayPlayFrom - Starts playing a log
+// Arguments: log - the log, kept until the replay is over
+//            length - bytes of log
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void replayPlayFrom(const unsigned char *log, int length)
+{
+    replayMode = REPLAY_MODE_PLAY;
+    // only read when playing
+    replayData = (unsigned char *)log;
+    replaySize = length;
+    replayLength = length;
+}
+
+///////////////////////////////////////////////////////////////////////
+// replayStart - Writes or reads the header of the log, call once with
+//               the seed before the game's stream is seeded
+// Arguments: seed - seed read from the sensors
+//            restX - joystick X reading at rest, set to the recorded one
+//                    when playing
+// Return Value: seed to use, the recorded one when playing (replayMode
+//               is set back to REPLAY_MODE_OFF if the log is not valid)
+///////////////////////////////////////////////////////////////////////
+int replayStart(int seed, int *restX)
+{
+    unsigned long recorded;
+
+    replayTick = 0;
+    replayJoystick = 0;
+
+    if(replayMode == REPLAY_MODE_RECORD) {
+        if(replaySize < REPLAY_HEADER + 2 * REPLAY_VARINT_MAX) {
+            replayMode = REPLAY_MODE_OFF;
+            return seed;
+        }
+        replayData[0] = 'P';
+        replayData[1] = 'W';
+        replayData[2] = REPLAY_VERSION;
+        replayData[3] = (unsigned char)seed;
+        replayData[4] = (unsigned char)(seed >> 8);
+        replayData[5] = (unsigned char)(seed >> 16);
+        replayData[6] = (unsigned char)(seed >> 24);
+        replayData[7] = (unsigned char)*restX;
+        replayData[8] = (unsigned char)(*restX >> 8);
+        replayLength = REPLAY_HEADER;
+        return seed;
+    }
+
+    if(replayMode == REPLAY_MODE_PLAY) {
+        if(replayLength < REPLAY_HEADER || replayData[0] != 'P' || replayData[1] != 'W'
+           || replayData[2] != REPLAY_VERSION) {
+            replayMode = REPLAY_MODE_OFF;
+            return seed;
+        }
+        recorded = replayData[3] | (unsigned long)replayData[4] << 8 | (unsigned long)replayData[5] << 16
+                   | (unsigned long)replayData[6] << 24;
+        *restX = replayData[7] | replayData[8] << 8;
+        replayPosition = REPLAY_HEADER;
+        return (int)recorded;
+    }
+
+    return seed;
+}
+
+///////////////////////////////////////////////////////////////////////
+// replayRecord - Adds an event to the log, nothing unless recording
+// Arguments: tick - ticks simulated before the event
+//            type - REPLAY_ type
+//            value - joystick reading of REPLAY_JOYSTICK, only logged
+//                    if it changed since the last one
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void replayRecord(unsigned long tick, int type, int value)
+{
+    long change = (long)value - replayJoystick;
+
+    if(replayMode != REPLAY_MODE_RECORD || (type == REPLAY_JOYSTICK && change == 0)) {
+        return;
+    }
+
+    // room for the biggest event and the REPLAY_END after it, else the log ends here
+    if(type != REPLAY_END && replayLength + 3 * REPLAY_VARINT_MAX > replaySize) {
+        type = REPLAY_END;
+    }
+
+    replayPut((tick - replayTick) << REPLAY_TYPE_BITS | type);
+    replayTick = tick;
+    if(type == REPLAY_JOYSTICK) {
+        // zigzag: small changes either way take one byte
+        replayPut(change < 0 ? ((unsigned long)(-change) << 1) - 1 : (unsigned long)change << 1);
+        replayJoystick = value;
+    } else if(type == REPLAY_END) {
+        replayMode = REPLAY_MODE_OFF;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// replayNext - Reads the next event of the log being played
+// Arguments: event - where the event is put
+// Return Value: true if there was one, false once the log is over
+///////////////////////////////////////////////////////////////////////
+int replayNext(replayEvent *event)
+{
+    unsigned long head;
+    unsigned long change;
+
+    if(replayMode != REPLAY_MODE_PLAY) {
+        return 0;
+    }
+    // a log cut short ends where it was cut
+    if(!replayGet(&head)) {
+        replayMode = REPLAY_MODE_OFF;
+        return 0;
+    }
+
+    replayTick += head >> REPLAY_TYPE_BITS;
+    event->tick = replayTick;
+    event->type = (int)(head & ((1 << REPLAY_TYPE_BITS) - 1));
+    event->value = replayJoystick;
+
+    if(event->type == REPLAY_JOYSTICK) {
+        if(!replayGet(&change)) {
+            replayMode = REPLAY_MODE_OFF;
+            return 0;
+        }
+        replayJoystick += (change & 1) ? -(int)((change + 1) >> 1) : (int)(change >> 1);
+        event->value = replayJoystick;
+    }
+    // REPLAY_END leaves the mode as it is, the ticks up to it are still to be played
+    return 1;
+}
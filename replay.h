@@ -0,0 +1,98 @@
+// Filename: replay.h
+// Description: Recording and replay of a session. The game only depends on the random seed,
+//              the joystick readings it moves the pedal with and the S1/S2 presses it acts on,
+//              so a log of those, stamped with the tick they came before, plays the session
+//              back tick for tick: the same game states, and the same frames from any renderer.
+//
+//              The log is binary and delta encoded. After a 9 byte header ("PW", the format
+//              version, the seed, 4 bytes little endian, and the joystick reading at rest the
+//              pedal is calibrated with, 2 bytes little endian) each event is a varint of
+//              (ticks since the last event << 2 | type), and a joystick event is followed by
+//              a zigzag varint of the change in the reading. A joystick reading is only
+//              logged when it changed. Varints are 7 bits per byte, low bits first, the top
+//              bit set on every byte but the last.
+//
+//              On the board, define REPLAY_RECORD_ENABLE to record into replayBuffer (read
+//              it out with the debugger, replayLength bytes), or define REPLAY_LOG_FILE as a
+//              header made with xxd -i -n replayRecorded from a log to play it back. The
+//              simulator records and plays logs from files (SIM_RECORD, SIM_REPLAY).
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+// Modes
+#define REPLAY_MODE_OFF     0       // inputs are neither recorded nor played
+#define REPLAY_MODE_RECORD  1
+#define REPLAY_MODE_PLAY    2
+
+// Event types
+#define REPLAY_JOYSTICK     0       // joystick X reading, the pedal input
+#define REPLAY_S1           1       // S1 acted on (pause or resume)
+#define REPLAY_S2           2       // S2 acted on (new game)
+#define REPLAY_END          3       // end of the log
+
+#define REPLAY_SIZE         8192    // bytes of replayBuffer, a few minutes of play
+#define REPLAY_VERSION      3       // 3: joystick rest reading in the header, 2: balls spawned from prng.c
+
+// One event of the log
+typedef struct {
+    unsigned long tick;             // ticks simulated before it
+    int type;                       // REPLAY_ type
+    int value;                      // joystick reading of REPLAY_JOYSTICK
+} replayEvent;
+
+extern int replayMode;                              // REPLAY_MODE_ value
+#ifdef REPLAY_RECORD_ENABLE
+extern unsigned char replayBuffer[REPLAY_SIZE];     // log recorded on the board, only kept when recording
+#endif
+extern int replayLength;                            // bytes of the log recorded or played
+
+///////////////////////////////////////////////////////////////////////
+// replayRecordTo - Starts recording into a buffer
+// Arguments: buffer - where the log is written
+//            size - bytes of buffer, recording stops (with a
+//                   REPLAY_END) once it is full
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void replayRecordTo(unsigned char *buffer, int size);
+
+///////////////////////////////////////////////////////////////////////
+// replayPlayFrom - Starts playing a log
+// Arguments: log - the log, kept until the replay is over
+//            length - bytes of log
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void replayPlayFrom(const unsigned char *log, int length);
+
+///////////////////////////////////////////////////////////////////////
+// replayStart - Writes or reads the header of the log, call once with
+//               the seed before the game's stream is seeded
+// Arguments: seed - seed read from the sensors
+//            restX - joystick X reading at rest, set to the recorded one
+//                    when playing
+// Return Value: seed to use, the recorded one when playing (replayMode
+//               is set back to REPLAY_MODE_OFF if the log is not valid)
+///////////////////////////////////////////////////////////////////////
+int replayStart(int seed, int *restX);
+
+///////////////////////////////////////////////////////////////////////
+// replayRecord - Adds an event to the log, nothing unless recording
+// Arguments: tick - ticks simulated before the event
+//            type - REPLAY_ type
+//            value - joystick reading of REPLAY_JOYSTICK, only logged
+//                    if it changed since the last one
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void replayRecord(unsigned long tick, int type, int value);
+
+///////////////////////////////////////////////////////////////////////
+// replayNext - Reads the next event of the log being played
+// Arguments: event - where the event is put
+// Return Value: true if there was one, false once the log is over
+///////////////////////////////////////////////////////////////////////
+int replayNext(replayEvent *event);
+
+#endif /* REPLAY_H_ */
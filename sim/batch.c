@@ -0,0 +1,368 @@
+// Filename: batch.c
+// Description: Headless batch simulator of whole games, for balance testing and as a benchmark
+//              of the game logic alone. Runs gameInit/gameUpdate with nothing drawn, the pedal
+//              moved by a paddle AI, on a pool of threads each taking games a chunk at a time.
+//
+//              paddle_batch [--games n] [--threads n] [--ai name] [--speed pixels] [--seed n]
+//
+//              Prints, for every level, the games that reached it, the share of them that
+//              cleared it and the ticks spent in it, then the win rate, the mean length of a
+//              game and the ticks and games simulated per second of wall time. The AIs are
+//              in batchAis, --ai picks one (default predict) and --speed caps how far it moves
+//              the pedal per tick (0 for no limit). Every game has its own stream of numbers
+//              (prng.h), so the figures only depend on the seed and not on the threads.
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#define _POSIX_C_SOURCE 200809L    // clock_gettime, sysconf
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "hal.h"
+#include "gamefunctions.h"
+#include "game.h"
+#include "collide.h"
+
+#define BATCH_GAMES         1000000     // games run without --games
+#define BATCH_CHUNK         1024        // games a thread takes at a time
+#define BATCH_THREADS_MAX   256
+#define BATCH_MAX_TICKS     100000      // a game still on after this many ticks is stopped (about 55 minutes)
+#define BATCH_SPEED         4           // pedal pixels per tick of the AI without --speed, a full joystick push
+#define BATCH_SEED          1           // seed of the games without --seed, game n takes stream n
+#define BATCH_TICK_HZ       (HAL_TICK_HZ / DROP_INTERVAL)   // ticks per second of the game
+#define BATCH_LEVELS        (END_LEVEL-START_LEVEL+1)
+
+// A paddle AI: where the pedal goes this tick, from the state of the game (pedalX is where it is)
+typedef int (*batchMove)(const gameContext *game);
+
+typedef struct {
+    const char *name;
+    const char *description;
+    batchMove move;
+} batchAi;
+
+// Figures of a share of the games, summed over the threads at the end
+typedef struct {
+    unsigned long long games;
+    unsigned long long wins;
+    unsigned long long losses;
+    unsigned long long stopped;                 // still on after BATCH_MAX_TICKS
+    unsigned long long ticks;
+    unsigned long long reached[BATCH_LEVELS];   // games that got to each level
+    unsigned long long cleared[BATCH_LEVELS];   // ... and went on past it
+    unsigned long long levelTicks[BATCH_LEVELS];
+} batchStats;
+
+// Frame counters printed by simFinish, kept by main.c in the game
+unsigned long frameCount;
+unsigned long ticksDropped;
+unsigned long ticksSimulated;
+
+static const batchAi *batchPlayer;
+static int batchSpeed = BATCH_SPEED;
+static unsigned long long batchGames = BATCH_GAMES;
+static unsigned long batchSeed = BATCH_SEED;
+static unsigned long long batchNext;            // first game not taken by a thread yet
+static pthread_mutex_t batchLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+///////////////////////////////////////////////////////////////////////
+// batchReflect - Folds an x position into the range the ball centre
+//                bounces between
+// Arguments: x - position, Q8.8, as if there were no sides
+// Return Value: position after the bounces off the sides
+///////////////////////////////////////////////////////////////////////
+static int batchReflect(int x)
+{
+    int low = FIX(LCD_MIN+BALL_RADIUS);
+    int span = FIX(LCD_MAX-BALL_RADIUS) - low;
+
+    x = (x - low) % (2 * span);
+    if(x < 0) {
+        x += 2 * span;
+    }
+    return low + (x > span ? 2 * span - x : x);
+}
+
+///////////////////////////////////////////////////////////////////////
+// batchLanding - Finds the falling ball that reaches the pedal first
+// Arguments: game - game being played
+//            landX - where the ball will be when it gets there, pixels
+// Return Value: ticks until it gets there, -1 if no ball is falling
+///////////////////////////////////////////////////////////////////////
+static int batchLanding(const gameContext *game, int *landX)
+{
+    int first = -1;
+    int ticks;
+    int ball;
+
+    for(ball = 0; ball < game->ballCount; ball++) {
+        if(game->ballVelY[ball] >= 0) {
+            continue;
+        }
+        ticks = (game->ballPosY[ball] - FIX(PEDAL_Y+PEDAL_HEIGHT+BALL_RADIUS)) / -game->ballVelY[ball];
+        if(ticks < 0) {
+            ticks = 0;
+        }
+        if(first < 0 || ticks < first) {
+            first = ticks;
+            *landX = FIX_PIXEL(batchReflect(game->ballPosX[ball] + game->ballVelX[ball] * ticks));
+        }
+    }
+    return first;
+}
+
+///////////////////////////////////////////////////////////////////////
+// batchToward - Moves the pedal toward a target, at most --speed pixels
+// Arguments: game - game being played
+//            target - where the pedal centre should go
+// Return Value: new pedal centre
+///////////////////////////////////////////////////////////////////////
+static int batchToward(const gameContext *game, int target)
+{
+    int step = target - game->pedalX;
+
+    if(batchSpeed > 0 && step > batchSpeed) {
+        step = batchSpeed;
+    } else if(batchSpeed > 0 && step < -batchSpeed) {
+        step = -batchSpeed;
+    }
+    return game->pedalX + step;
+}
+
+///////////////////////////////////////////////////////////////////////
+// batchTrack - AI keeping the pedal under the lowest ball
+// Arguments: game - game being played
+// Return Value: new pedal centre
+///////////////////////////////////////////////////////////////////////
+static int batchTrack(const gameContext *game)
+{
+    int lowest = 0;
+    int ball;
+
+    for(ball = 1; ball < game->ballCount; ball++) {
+        if(game->ballPosY[ball] < game->ballPosY[lowest]) {
+            lowest = ball;
+        }
+    }
+    return batchToward(game, game->ballX[lowest]);
+}
+
+///////////////////////////////////////////////////////////////////////
+// batchPredict - AI moving the pedal to where the next ball will come
+//                down, bounces off the sides included
+// Arguments: game - game being played
+// Return Value: new pedal centre
+///////////////////////////////////////////////////////////////////////
+static int batchPredict(const gameContext *game)
+{
+    int landX;
+
+    if(batchLanding(game, &landX) < 0) {
+        return batchTrack(game);
+    }
+    return batchToward(game, landX);
+}
+
+///////////////////////////////////////////////////////////////////////
+// batchCentre - AI leaving the pedal in the middle, a floor for the
+//               others
+// Arguments: game - game being played
+// Return Value: new pedal centre
+///////////////////////////////////////////////////////////////////////
+static int batchCentre(const gameContext *game)
+{
+    return batchToward(game, (LCD_MIN+LCD_MAX)/2);
+}
+
+static const batchAi batchAis[] = {
+    { "predict", "moves to where the next falling ball will reach the pedal", batchPredict },
+    { "track",   "follows the lowest ball",                                   batchTrack },
+    { "centre",  "stays in the middle",                                       batchCentre },
+};
+#define BATCH_AIS           ((int)(sizeof(batchAis) / sizeof(batchAis[0])))
+
+///////////////////////////////////////////////////////////////////////
+// batchPlay - Plays one game to its end with the AI, nothing drawn
+// Arguments: stats - where the figures of the game are added
+//            number - number of the game in the batch, its stream
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void batchPlay(batchStats *stats, unsigned long long number)
+{
+    gameContext game;
+    unsigned long ticks = 0;
+    unsigned long levelStart = 0;
+    int level;
+
+    prngSeed(&game.rng, batchSeed, (unsigned long)number);
+    gameInit(&game);
+    game.pedalX = (LCD_MIN+LCD_MAX)/2;
+    level = game.level;
+    stats->reached[level]++;
+
+    while(game.gameState == GAME_ON && ticks < BATCH_MAX_TICKS) {
+        game.pedalX = batchPlayer->move(&game);
+        gameUpdate(&game);
+        ticks++;
+
+        if(game.level != level) {
+            stats->cleared[level]++;
+            stats->levelTicks[level] += ticks - levelStart;
+            levelStart = ticks;
+            level = game.level;
+            if(level <= END_LEVEL) {
+                stats->reached[level]++;
+            }
+        }
+    }
+
+    if(level <= END_LEVEL) {
+        stats->levelTicks[level] += ticks - levelStart;
+    }
+    stats->games++;
+    stats->ticks += ticks;
+    if(game.gameState == GAME_ON) {
+        stats->stopped++;
+    } else if(game.level > END_LEVEL) {
+        stats->wins++;
+    } else {
+        stats->losses++;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// batchWorker - Thread of the pool, takes chunks of games until they
+//               are all taken
+// Arguments: arg - batchStats the figures of the thread are put in
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void *batchWorker(void *arg)
+{
+    batchStats stats;           // kept on the thread's own stack until the end, no cache line is shared
+    unsigned long long first;   // first game of the chunk
+    unsigned long long count;
+
+    memset(&stats, 0, sizeof(stats));
+
+    while(1) {
+        pthread_mutex_lock(&batchLock);
+        count = batchGames - batchNext;
+        if(count > BATCH_CHUNK) {
+            count = BATCH_CHUNK;
+        }
+        first = batchNext;
+        batchNext += count;
+        pthread_mutex_unlock(&batchLock);
+
+        if(count == 0) {
+            memcpy(arg, &stats, sizeof(stats));
+            return 0;
+        }
+        while(count-- > 0) {
+            batchPlay(&stats, first++);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// batchPrint - Prints the figures of the whole batch
+// Arguments: total - figures summed over the threads
+//            threads - threads the batch ran on
+//            seconds - wall time it took
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void batchPrint(const batchStats *total, int threads, double seconds)
+{
+    int level;
+
+    printf("batch: %llu games, ai %s, speed %d, %d threads\n", total->games, batchPlayer->name, batchSpeed, threads);
+    printf("%-6s %12s %12s %9s %12s\n", "level", "reached", "cleared", "rate", "mean ticks");
+    for(level = 0; level < BATCH_LEVELS; level++) {
+        printf("%-6d %12llu %12llu %8.2f%% %12.1f\n", level + 1, total->reached[level], total->cleared[level],
+               total->reached[level] ? 100.0 * total->cleared[level] / total->reached[level] : 0.0,
+               total->reached[level] ? (double)total->levelTicks[level] / total->reached[level] : 0.0);
+    }
+    printf("win rate %.2f%% (%llu won, %llu lost, %llu stopped at %d ticks)\n",
+           total->games ? 100.0 * total->wins / total->games : 0.0, total->wins, total->losses, total->stopped,
+           BATCH_MAX_TICKS);
+    printf("mean game %.1f ticks (%.1f s)\n", total->games ? (double)total->ticks / total->games : 0.0,
+           total->games ? (double)total->ticks / total->games / BATCH_TICK_HZ : 0.0);
+    printf("%.3f s, %.0f ticks/s, %.0f games/min\n", seconds, seconds > 0 ? total->ticks / seconds : 0.0,
+           seconds > 0 ? total->games * 60.0 / seconds : 0.0);
+}
+
+void main(int argc, char **argv)
+{
+    static batchStats stats[BATCH_THREADS_MAX];
+    pthread_t workers[BATCH_THREADS_MAX];
+    batchStats total;
+    struct timespec start, end;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *ai = batchAis[0].name;
+    int arg, index, level;
+
+    for(arg = 1; arg < argc; arg++) {
+        if(!strcmp(argv[arg], "--games") && arg + 1 < argc) {
+            batchGames = strtoull(argv[++arg], 0, 10);
+        } else if(!strcmp(argv[arg], "--threads") && arg + 1 < argc) {
+            threads = atol(argv[++arg]);
+        } else if(!strcmp(argv[arg], "--ai") && arg + 1 < argc) {
+            ai = argv[++arg];
+        } else if(!strcmp(argv[arg], "--speed") && arg + 1 < argc) {
+            batchSpeed = atoi(argv[++arg]);
+        } else if(!strcmp(argv[arg], "--seed") && arg + 1 < argc) {
+            batchSeed = strtoul(argv[++arg], 0, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--games n] [--threads n] [--ai name] [--speed pixels] [--seed n]\n", argv[0]);
+            for(index = 0; index < BATCH_AIS; index++) {
+                fprintf(stderr, "  --ai %-8s %s\n", batchAis[index].name, batchAis[index].description);
+            }
+            exit(2);
+        }
+    }
+
+    for(index = 0; index < BATCH_AIS && strcmp(batchAis[index].name, ai); index++) {
+    }
+    if(index == BATCH_AIS) {
+        fprintf(stderr, "batch: no ai called %s\n", ai);
+        exit(2);
+    }
+    batchPlayer = &batchAis[index];
+    if(threads < 1) {
+        threads = 1;
+    } else if(threads > BATCH_THREADS_MAX) {
+        threads = BATCH_THREADS_MAX;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(index = 0; index < threads; index++) {
+        if(pthread_create(&workers[index], 0, batchWorker, &stats[index])) {
+            fprintf(stderr, "batch: cannot start thread %d\n", index);
+            exit(1);
+        }
+    }
+    memset(&total, 0, sizeof(total));
+    for(index = 0; index < threads; index++) {
+        pthread_join(workers[index], 0);
+        total.games += stats[index].games;
+        total.wins += stats[index].wins;
+        total.losses += stats[index].losses;
+        total.stopped += stats[index].stopped;
+        total.ticks += stats[index].ticks;
+        for(level = 0; level < BATCH_LEVELS; level++) {
+            total.reached[level] += stats[index].reached[level];
+            total.cleared[level] += stats[index].cleared[level];
+            total.levelTicks[level] += stats[index].levelTicks[level];
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    batchPrint(&total, (int)threads, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    exit(0);
+} // end main
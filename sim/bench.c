@@ -0,0 +1,517 @@
+// Filename: bench.c
+// Description: Benchmark of the render primitives and of full game frames. Runs them on the
+//              simulated HAL, so the bytes counted are the exact bytes lcdWrite and the DMA
+//              would send to the ST7735, and the cycles are MCLK cycles of virtual time
+//              (HAL calls and bus time, not the CPU time of the game code itself).
+//
+//              paddle_bench [--csv | --json] [--baseline file.csv] [--tolerance percent] [--clocks]
+//
+//              Prints one row per benchmark, every figure per call. --baseline compares the
+//              run with a CSV saved by an earlier --csv run and fails (exit 1) if the SPI
+//              bytes, transactions or cycles of any benchmark grew by more than the tolerance.
+//              Every clock configuration of clocks.h is checked first, a bad one fails the
+//              run too; --clocks prints the bus timings they give. The table also has the
+//              host time of gameUpdate with 1 to BALLS_MAX balls in play, which is not
+//              compared with the baseline.
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hal.h"
+#include "lcd.h"
+#include "gamefunctions.h"
+#include "game.h"
+#include "collide.h"
+#include "sim.h"
+
+#define BENCH_MAX           16          // most benchmarks in a run or a baseline
+#define BENCH_NAME_SIZE     32
+#define BENCH_TOLERANCE     2.0         // default regression tolerance, percent
+#define BENCH_SEED          1           // seed of the game's numbers in the game frames
+
+// Calls made by each benchmark
+#define CLEAR_CALLS         8
+#define PIXEL_CALLS         1024
+#define PEDAL_CALLS         256
+#define BALL_CALLS          256
+#define TEXT_CALLS          256
+#define FRAME_CALLS         2000
+#define FRAME_SWEEP         96          // ticks for the scripted pedal to cross the screen and back
+#define BALL_STEP           7           // pixels the ball drops per moveBall call
+#define UPDATE_REPS         20000       // games timed for each number of balls ...
+#define UPDATE_TICKS        8           // ... for this many gameUpdate calls each, all balls stay in the air
+
+// Output formats
+#define FORMAT_TABLE        0
+#define FORMAT_CSV          1
+#define FORMAT_JSON         2
+
+// Figures of one benchmark, per call
+typedef struct {
+    char name[BENCH_NAME_SIZE];
+    unsigned long calls;
+    double spiBytes;        // command and data bytes
+    double commandBytes;
+    double dataBytes;
+    double transactions;    // single byte writes and DMA runs
+    double windows;         // CASET and RASET
+    double writes;          // RAMWR
+    double pixels;
+    double cycles;          // MCLK cycles of virtual time, bus time included (at CLOCK_CONFIG)
+} benchResult;
+
+// Frame counters printed by simFinish, kept by main.c in the game
+unsigned long frameCount;
+unsigned long ticksDropped;
+unsigned long ticksSimulated;
+
+// Host time of gameUpdate with a number of balls in play
+typedef struct {
+    int balls;
+    double updateNs;        // per gameUpdate call
+    double ballNs;          // per ball
+} benchUpdateResult;
+
+static const int benchUpdateBalls[] = { 1, 2, 4, BALLS_MAX };
+#define UPDATE_COUNTS       ((int)(sizeof(benchUpdateBalls) / sizeof(benchUpdateBalls[0])))
+
+static benchResult benchResults[BENCH_MAX];
+static int benchCount;
+static benchUpdateResult benchUpdates[UPDATE_COUNTS];
+static unsigned long benchTransfers;    // simSpiTransfers at benchStart
+static unsigned long long benchTime;    // simNow at benchStart
+
+
+///////////////////////////////////////////////////////////////////////
+// benchFlush - Sends what was drawn, like the main loop does after each
+//              frame (nothing to send unless built with LCD_FRAMEBUFFER)
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void benchFlush(void)
+{
+    lcdFlush(0, 0, LCD_MAX_X, LCD_MAX_Y);
+}
+
+///////////////////////////////////////////////////////////////////////
+// benchStart - Starts measuring, once the LCD has finished the work of
+//              the last benchmark
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void benchStart(void)
+{
+    lcdDmaWait();
+    st7735ClearCounters(simPanel());
+    benchTransfers = simSpiTransfers();
+    benchTime = simNow();
+}
+
+///////////////////////////////////////////////////////////////////////
+// benchStop - Stops measuring once everything queued has been sent, and
+//             records the figures per call
+// Arguments: name - name of the benchmark
+//            calls - calls made since benchStart
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void benchStop(const char *name, unsigned long calls)
+{
+    const st7735Counters *counters = &simPanel()->counters;
+    benchResult *result = &benchResults[benchCount++];
+
+    lcdDmaWait();
+
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->calls = calls;
+    result->commandBytes = (double)counters->commandBytes / calls;
+    result->dataBytes = (double)counters->dataBytes / calls;
+    result->spiBytes = result->commandBytes + result->dataBytes;
+    result->transactions = (double)(simSpiTransfers() - benchTransfers) / calls;
+    result->windows = (double)counters->windows / calls;
+    result->writes = (double)counters->writes / calls;
+    result->pixels = (double)counters->pixels / calls;
+    result->cycles = (double)(simNow() - benchTime) * HAL_MCLK_HZ / 1e9 / calls;
+}
+
+///////////////////////////////////////////////////////////////////////
+// benchPrimitives - Benchmarks the drawing functions one at a time
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void benchPrimitives(void)
+{
+    int call;
+    int x;
+    fontText text;
+    char string[FONT_TEXT_MAX + 1];
+
+    benchStart();
+    for(call = 0; call < CLEAR_CALLS; call++) {
+        lcdClear((call & 1) ? BG_COLOR : BLACK);
+        benchFlush();
+    }
+    benchStop("lcdClear", CLEAR_CALLS);
+
+    // spread over the screen, no two pixels in a row next to each other
+    benchStart();
+    for(call = 0; call < PIXEL_CALLS; call++) {
+        lcdSetPixel((call * 37) % (LCD_MAX_X + 1), (call * 91) % (LCD_MAX_Y + 1), call);
+        benchFlush();
+    }
+    benchStop("lcdSetPixel", PIXEL_CALLS);
+
+    // whole pedal, nothing on screen before
+    benchStart();
+    for(call = 0; call < PEDAL_CALLS; call++) {
+        writePedal(PEDAL_WIDTH + call % (LCD_MAX_X + 1 - 2 * PEDAL_WIDTH), PEDAL_NONE);
+        benchFlush();
+    }
+    benchStop("writePedal_full", PEDAL_CALLS);
+
+    // pedal moved one pixel, back and forth
+    x = LCD_MAX_X / 2;
+    writePedal(x, PEDAL_NONE);
+    benchFlush();
+    benchStart();
+    for(call = 0; call < PEDAL_CALLS; call++) {
+        writePedal(x + 1 - (call & 1), x + (call & 1));
+        benchFlush();
+    }
+    benchStop("writePedal_step", PEDAL_CALLS);
+
+    lcdClear(BG_COLOR);
+    benchFlush();
+
+    // ball drawn then erased, all over the screen
+    benchStart();
+    for(call = 0; call < BALL_CALLS; call++) {
+        x = BALL_RADIUS + (call * 29) % (LCD_MAX_X + 1 - 2 * BALL_RADIUS);
+        writeBall(x, BALL_RADIUS + (call * 53) % (LCD_MAX_Y + 1 - 2 * BALL_RADIUS), (call & 1) ? ERASE : WRITE);
+        benchFlush();
+    }
+    benchStop("writeBall", BALL_CALLS);
+
+    // ball dropped one tick, drifting sideways
+    x = LCD_MAX_X / 2;
+    writeBall(x, BALL_Y_SPAWN, WRITE);
+    benchFlush();
+    benchStart();
+    for(call = 0; call < BALL_CALLS; call++) {
+        moveBall(x, BALL_Y_SPAWN - (call % 16) * BALL_STEP, x + ((call & 2) ? -1 : 1),
+                 BALL_Y_SPAWN - (call % 16 + 1) * BALL_STEP);
+        benchFlush();
+        x += (call & 2) ? -1 : 1;
+    }
+    benchStop("moveBall", BALL_CALLS);
+
+    // HUD score counting up, one hit per call
+    fontTextInit(&text, HUD_SCORE_X, HUD_TEXT_Y, HUD_TEXT, HUD_BG);
+    fontTextDraw(&text, "SCORE 0");
+    benchFlush();
+    benchStart();
+    for(call = 0; call < TEXT_CALLS; call++) {
+        strcpy(string, "SCORE ");
+        fontNumber(string + strlen(string), call + 1);
+        fontTextDraw(&text, string);
+        benchFlush();
+    }
+    benchStop("fontTextDraw", TEXT_CALLS);
+}
+
+///////////////////////////////////////////////////////////////////////
+// benchFrames - Benchmarks the game's update and render steps, one tick
+//               per frame, with the pedal sweeping from side to side so
+//               that balls are both caught and missed (new games and
+//               end screens are part of the figures)
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void benchFrames(void)
+{
+    gameContext game;
+    int call;
+    int phase;
+
+    prngSeed(&game.rng, BENCH_SEED, 0);
+    gameInit(&game);
+    game.pedalX = LCD_MAX_X / 2;
+    gameRender(&game);
+    benchFlush();
+
+    benchStart();
+    for(call = 0; call < FRAME_CALLS; call++) {
+        // end screen: straight into a new game
+        if(game.gameState != GAME_ON) {
+            gameInit(&game);
+        }
+
+        phase = call % FRAME_SWEEP;
+        if(phase >= FRAME_SWEEP / 2) {
+            phase = FRAME_SWEEP - phase;
+        }
+        game.pedalX = phase * LCD_MAX_X / (FRAME_SWEEP / 2);
+
+        gameUpdate(&game);
+        gameRender(&game);
+        benchFlush();
+        frameCount++;
+    }
+    benchStop("frame", FRAME_CALLS);
+}
+
+///////////////////////////////////////////////////////////////////////
+// benchUpdate - Times gameUpdate on the host CPU with 1 up to BALLS_MAX
+//               balls in play, spread down the screen so none is hit or
+//               lost while it is timed. This is host time (halCycles), it
+//               shows how the update scales with the balls but is too
+//               noisy to compare with a baseline.
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void benchUpdate(void)
+{
+    gameContext start, game;
+    unsigned long long total;
+    unsigned long begin;
+    int count;
+    int ball;
+    int rep;
+    int tick;
+
+    for(count = 0; count < UPDATE_COUNTS; count++) {
+        prngSeed(&start.rng, BENCH_SEED, 0);
+        gameInit(&start);
+        start.pedalX = LCD_MAX_X / 2;
+        start.ballCount = benchUpdateBalls[count];
+        for(ball = 0; ball < start.ballCount; ball++) {
+            ballSpawn(&start, ball);
+            start.ballY[ball] -= ball * (BALL_Y_SPAWN - UPDATE_TICKS * BALL_STEP) / BALLS_MAX;
+            start.ballPosY[ball] = FIX(start.ballY[ball]);
+        }
+
+        total = 0;
+        for(rep = 0; rep < UPDATE_REPS; rep++) {
+            game = start;
+            begin = halCycles();
+            for(tick = 0; tick < UPDATE_TICKS; tick++) {
+                gameUpdate(&game);
+            }
+            total += halCycles() - begin;
+        }
+
+        benchUpdates[count].balls = start.ballCount;
+        benchUpdates[count].updateNs = (double)total / UPDATE_REPS / UPDATE_TICKS;
+        benchUpdates[count].ballNs = benchUpdates[count].updateNs / start.ballCount;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// benchClocks - Checks every clock configuration, and prints the bus
+//               timings each one gives
+// Arguments: print - true to print the timings
+// Return Value: number of bad configurations
+///////////////////////////////////////////////////////////////////////
+static int benchClocks(int print)
+{
+    const clockConfig *config;
+    const char *problem;
+    int bad = 0;
+    int index;
+
+    if(print) {
+        printf("%-8s %10s %10s %10s %8s %8s %10s %12s\n", "clock", "mclk Hz", "smclk Hz", "spi Hz",
+               "i2c Hz", "tick Hz", "byte ns", "lcdClear ms");
+    }
+
+    for(index = 0; index < CLOCK_CONFIGS; index++) {
+        config = &clockConfigs[index];
+        problem = clockCheck(config);
+        if(problem) {
+            fprintf(stderr, "bench: clock configuration %s: %s\n", config->name, problem);
+            bad++;
+        }
+        if(print) {
+            // a clear is the window, then every pixel of the screen
+            printf("%-8s %10lu %10lu %10lu %8lu %8lu %10llu %12.3f%s\n", config->name, config->dcoHz,
+                   clockSmclkHz(config), clockSpiHz(config), clockI2cHz(config), clockTickHz(config),
+                   clockSpiNs(config, 1), clockSpiNs(config, 11 + 2 * (LCD_MAX_X + 1) * (LCD_MAX_Y + 1)) / 1e6,
+                   index == CLOCK_CONFIG ? " (built)" : "");
+        }
+    }
+    if(print) {
+        printf("\n");
+    }
+    return bad;
+}
+
+///////////////////////////////////////////////////////////////////////
+// benchPrint - Prints the results
+// Arguments: format - FORMAT_ value
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void benchPrint(int format)
+{
+    const benchResult *result;
+    int index;
+
+    if(format == FORMAT_CSV) {
+        printf("name,calls,spi_bytes,command_bytes,data_bytes,transactions,windows,writes,pixels,cycles\n");
+    } else if(format == FORMAT_JSON) {
+        printf("[\n");
+    } else {
+        printf("%-16s %6s %10s %9s %10s %12s %8s %7s %9s %10s\n", "benchmark", "calls", "spi bytes",
+               "commands", "data", "transactions", "windows", "writes", "pixels", "cycles");
+    }
+
+    for(index = 0; index < benchCount; index++) {
+        result = &benchResults[index];
+        if(format == FORMAT_CSV) {
+            printf("%s,%lu,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n", result->name, result->calls,
+                   result->spiBytes, result->commandBytes, result->dataBytes, result->transactions,
+                   result->windows, result->writes, result->pixels, result->cycles);
+        } else if(format == FORMAT_JSON) {
+            printf("  {\"name\": \"%s\", \"calls\": %lu, \"spi_bytes\": %.1f, \"command_bytes\": %.1f, "
+                   "\"data_bytes\": %.1f, \"transactions\": %.1f, \"windows\": %.1f, \"writes\": %.1f, "
+                   "\"pixels\": %.1f, \"cycles\": %.1f}%s\n", result->name, result->calls,
+                   result->spiBytes, result->commandBytes, result->dataBytes, result->transactions,
+                   result->windows, result->writes, result->pixels, result->cycles,
+                   index < benchCount - 1 ? "," : "");
+        } else {
+            printf("%-16s %6lu %10.1f %9.1f %10.1f %12.1f %8.1f %7.1f %9.1f %10.1f\n", result->name,
+                   result->calls, result->spiBytes, result->commandBytes, result->dataBytes,
+                   result->transactions, result->windows, result->writes, result->pixels, result->cycles);
+        }
+    }
+
+    if(format == FORMAT_JSON) {
+        printf("]\n");
+    }
+
+    // host time is left out of the CSV and JSON, they are what baselines are made of
+    if(format == FORMAT_TABLE) {
+        printf("\n%-16s %6s %10s %10s\n", "gameUpdate", "balls", "host ns", "ns/ball");
+        for(index = 0; index < UPDATE_COUNTS; index++) {
+            printf("%-16s %6d %10.1f %10.1f\n", "", benchUpdates[index].balls,
+                   benchUpdates[index].updateNs, benchUpdates[index].ballNs);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// benchRegressed - Checks one figure against its baseline
+// Arguments: name, figure - what is checked, for the message
+//            value - figure of this run
+//            baseline - figure of the baseline
+//            tolerance - growth allowed, percent
+// Return Value: true (and a message on stderr) if the figure grew too much
+///////////////////////////////////////////////////////////////////////
+static int benchRegressed(const char *name, const char *figure, double value, double baseline, double tolerance)
+{
+    if(value <= baseline * (1.0 + tolerance / 100.0) + 0.05) {
+        return 0;
+    }
+    fprintf(stderr, "bench: %s %s regressed: %.1f, baseline %.1f (+%.1f%%)\n", name, figure, value,
+            baseline, baseline > 0 ? (value - baseline) * 100.0 / baseline : 100.0);
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// benchCompare - Compares the results with a baseline saved by --csv
+// Arguments: path - file name of the baseline
+//            tolerance - growth allowed, percent
+// Return Value: number of figures that regressed
+///////////////////////////////////////////////////////////////////////
+static int benchCompare(const char *path, double tolerance)
+{
+    FILE *file = fopen(path, "r");
+    char line[256];
+    benchResult baseline;
+    int regressions = 0;
+    int found;
+    int index;
+
+    if(!file) {
+        fprintf(stderr, "bench: cannot open baseline %s\n", path);
+        exit(2);
+    }
+
+    while(fgets(line, sizeof(line), file)) {
+        // the header and anything else that is not a row of figures is skipped
+        if(sscanf(line, "%31[^,],%lu,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf", baseline.name, &baseline.calls,
+                  &baseline.spiBytes, &baseline.commandBytes, &baseline.dataBytes, &baseline.transactions,
+                  &baseline.windows, &baseline.writes, &baseline.pixels, &baseline.cycles) != 10) {
+            continue;
+        }
+
+        found = 0;
+        for(index = 0; index < benchCount; index++) {
+            if(!strcmp(benchResults[index].name, baseline.name)) {
+                regressions += benchRegressed(baseline.name, "spi_bytes", benchResults[index].spiBytes,
+                                              baseline.spiBytes, tolerance);
+                regressions += benchRegressed(baseline.name, "transactions", benchResults[index].transactions,
+                                              baseline.transactions, tolerance);
+                regressions += benchRegressed(baseline.name, "cycles", benchResults[index].cycles,
+                                              baseline.cycles, tolerance);
+                found = 1;
+            }
+        }
+        if(!found) {
+            fprintf(stderr, "bench: %s is in the baseline but was not run\n", baseline.name);
+        }
+    }
+
+    fclose(file);
+    return regressions;
+}
+
+void main(int argc, char **argv)
+{
+    const char *baseline = 0;
+    double tolerance = BENCH_TOLERANCE;
+    int format = FORMAT_TABLE;
+    int clocks = 0;
+    int regressions;
+    int arg;
+
+    for(arg = 1; arg < argc; arg++) {
+        if(!strcmp(argv[arg], "--csv")) {
+            format = FORMAT_CSV;
+        } else if(!strcmp(argv[arg], "--json")) {
+            format = FORMAT_JSON;
+        } else if(!strcmp(argv[arg], "--baseline") && arg + 1 < argc) {
+            baseline = argv[++arg];
+        } else if(!strcmp(argv[arg], "--tolerance") && arg + 1 < argc) {
+            tolerance = atof(argv[++arg]);
+        } else if(!strcmp(argv[arg], "--clocks")) {
+            clocks = 1;
+        } else {
+            fprintf(stderr, "usage: %s [--csv | --json] [--baseline file.csv] [--tolerance percent] [--clocks]\n", argv[0]);
+            exit(2);
+        }
+    }
+
+    regressions = benchClocks(clocks);
+
+    // same start up as the game, without the interrupts: the DMA queue is polled
+    halInit();
+    simSetEnd(SIM_NEVER);
+    lcdInit();
+    ballSpriteInit();
+
+    benchPrimitives();
+    benchFrames();
+    benchUpdate();
+
+    benchPrint(format);
+
+    if(baseline) {
+        regressions += benchCompare(baseline, tolerance);
+    }
+    if(regressions) {
+        fprintf(stderr, "bench: %d regression(s)\n", regressions);
+    }
+    exit(regressions ? 1 : 0);
+} // end main
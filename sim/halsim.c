@@ -0,0 +1,1062 @@
+// Filename: halsim.c
+// Description: Hardware abstraction layer for the Linux simulator. Time only passes when
+//              the code calls into the HAL: every call costs SIM_CALL_NS, delays and SPI/i2c
+//              transfers cost their real duration, and the interrupts that come due on the
+//              way run in order, as long as interrupts are enabled.
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#define _POSIX_C_SOURCE 199309L    // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hal.h"
+#include "adc.h"
+#include "probe.h"
+#include "replay.h"
+#include "sim.h"
+
+#define SIM_DEFAULT_MS      10000           // run length without SIM_MS
+#define SIM_CALL_NS         (10 * 1000000000ULL / HAL_MCLK_HZ)     // CPU time charged for every HAL call (~10 cycles)
+#define SIM_ADC_NS          5000ULL         // conversion time of one channel
+#define SIM_RECOVERY_NS     100000ULL       // time taken by an i2c bus recovery
+#define SIM_SWEEP_MS        4000            // period of the joystick sweep without a script
+#define SIM_SCRIPT_SIZE     512             // most events in a script
+#define SIM_JS_X_AIN        15              // joystick X analog input on the BoosterPack
+#define SIM_JS_Y_AIN        9               // joystick Y analog input on the BoosterPack
+#define SIM_ADC_MAX         16383           // full scale of the 14 bit ADC
+#define SIM_RECORD_SIZE     (1 << 20)       // bytes of a recording, hours of play
+#define SIM_HASH_BASIS      2166136261UL    // FNV-1a offset basis
+#define SIM_HASH_PRIME      16777619UL      // FNV-1a prime
+
+// Script events
+#define EVENT_JS_X          0
+#define EVENT_JS_Y          1
+#define EVENT_S1            2
+#define EVENT_S2            3
+#define EVENT_END           4
+
+// Interrupt sources, in priority order when due at the same time
+#define SOURCE_NONE         -1
+#define SOURCE_DMA          0
+#define SOURCE_I2C          1
+#define SOURCE_ADC          2
+#define SOURCE_TICK         3
+#define SOURCE_BUTTON       4
+
+// One line of the input script
+typedef struct {
+    unsigned long long at;  // virtual time of the event
+    int type;               // EVENT_ type
+    int value;              // joystick reading for EVENT_JS_
+} simEvent;
+
+// One register of a fake i2c sensor
+typedef struct {
+    char slaveAddr;
+    char regAddr;
+    int value;
+} simRegister;
+
+// Sensors on the BoosterPack, a few registers each
+static simRegister simRegisters[] = {
+    { OPT3001_SLAVE_ADDRESS, OPT3001_RESULT_REG,      0x5A3C },
+    { OPT3001_SLAVE_ADDRESS, OPT3001_CONFIG_REG,      0xC810 },
+    { OPT3001_SLAVE_ADDRESS, OPT3001_DEVICE_ID_REG,   0x3001 },
+    { TMP006_SLAVE_ADDRESS,  TMP006_VOLTAGE_REG,      0xFF3B },
+    { TMP006_SLAVE_ADDRESS,  TMP006_TEMPERATURE_REG,  0x0C80 },
+    { TMP006_SLAVE_ADDRESS,  TMP006_DEVICE_ID_REG,    0x0067 },
+};
+
+// Frame counters kept by main.c (bench.c in the benchmark), printed by simFinish
+extern unsigned long frameCount;
+extern unsigned long ticksDropped;
+extern unsigned long ticksSimulated;
+
+static unsigned long long simTime;          // virtual time in ns
+static unsigned long long simEnd;           // virtual time the run stops at
+static int simIrqEnabled;                   // interrupts enabled globally
+static int simInIsr;                        // an interrupt handler is running
+
+static simEvent simScript[SIM_SCRIPT_SIZE];
+static int simScriptLength;
+static int simButtonIndex;                  // next script event checked for a button press
+
+static const char *simPpm;                 // file the last frame is saved to, or 0
+static const char *simPpmDir;               // directory snapshots are saved to, or 0
+static unsigned long long simPpmEvery;      // ns between snapshots
+static unsigned long long simPpmNext;
+
+static const char *simRecordPath;           // file the recording is saved to, or 0
+static unsigned char *simLog;               // log recorded or played
+static int simReplaying;                    // playing simLog back
+static unsigned long simHash = SIM_HASH_BASIS;  // hash of the frames of the replay
+static unsigned long simHashedFrames;
+
+static st7735 simLcd;
+static unsigned long long spiHz;           // UCB0 bit clock, from the clock configuration unless SIM_SPI_HZ says otherwise
+static unsigned long long i2cHz;           // UCB1 bit clock
+static unsigned long long spiFreeAt;        // time the last SPI byte is shifted out
+static unsigned long spiTransfers;          // single byte writes and DMA runs started
+
+static void (*dmaHandler)(void);
+static int dmaActive;                       // DMA started and its flag not cleared yet
+static int dmaIrqPending;                   // DMA interrupt not run yet
+static unsigned long long dmaDoneAt;
+
+static void (*adcHandler)(const int *results);
+static int adcChannels[ADC_MAX_CHANNELS];
+static int adcCount = 1;
+static unsigned long long adcPeriod;        // ns between continuous bursts
+static unsigned long long adcNext = SIM_NEVER;
+
+static void (*i2cHandler)(void);
+static i2cTransaction *i2cOnBus;
+static int i2cStatus;                       // status the transaction on the bus ends with
+static int i2cIrqPending;
+static unsigned long long i2cDoneAt;
+
+static void (*buttonHandler)(int button);
+
+static void (*tickHandler)(void);
+static unsigned long long tickPeriod;       // ns between ticks
+static unsigned long long tickNext = SIM_NEVER;
+
+
+///////////////////////////////////////////////////////////////////////
+// simLoadScript - Reads the input script into simScript, sorted by time
+// Arguments: path - file name of the script
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void simLoadScript(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[128];
+    char name[8];
+    unsigned long ms;
+    int value;
+    int index;
+    simEvent event;
+
+    if(!file) {
+        fprintf(stderr, "sim: cannot open script %s\n", path);
+        exit(1);
+    }
+
+    while(fgets(line, sizeof(line), file)) {
+        if(strchr(line, '#')) {
+            *strchr(line, '#') = '\0';
+        }
+        value = 0;
+        if(sscanf(line, "%lu %7s %d", &ms, name, &value) < 2) {
+            continue;
+        }
+
+        event.at = ms * SIM_NS_PER_MS;
+        event.value = value;
+        if(!strcmp(name, "js")) {
+            event.type = EVENT_JS_X;
+        } else if(!strcmp(name, "jy")) {
+            event.type = EVENT_JS_Y;
+        } else if(!strcmp(name, "s1")) {
+            event.type = EVENT_S1;
+        } else if(!strcmp(name, "s2")) {
+            event.type = EVENT_S2;
+        } else if(!strcmp(name, "end")) {
+            event.type = EVENT_END;
+        } else {
+            fprintf(stderr, "sim: unknown script event %s\n", name);
+            exit(1);
+        }
+
+        if(simScriptLength >= SIM_SCRIPT_SIZE) {
+            fprintf(stderr, "sim: script longer than %d events\n", SIM_SCRIPT_SIZE);
+            exit(1);
+        }
+
+        // insert after every event at the same time or earlier, so lines keep their order
+        for(index = simScriptLength; index > 0 && simScript[index - 1].at > event.at; index--) {
+            simScript[index] = simScript[index - 1];
+        }
+        simScript[index] = event;
+        simScriptLength++;
+
+        if(event.type == EVENT_END && event.at < simEnd) {
+            simEnd = event.at;
+        }
+    }
+
+    fclose(file);
+}
+
+///////////////////////////////////////////////////////////////////////
+// simJoystick - Gets the scripted joystick reading at the current time
+// Arguments: type - EVENT_JS_X or EVENT_JS_Y
+// Return Value: ADC reading of the axis
+///////////////////////////////////////////////////////////////////////
+static int simJoystick(int type)
+{
+    const simEvent *before = 0;     // last point of the axis at or before now
+    const simEvent *after = 0;      // first point of the axis after now
+    unsigned long long phase;
+    int index;
+
+    for(index = 0; index < simScriptLength; index++) {
+        if(simScript[index].type != type) {
+            continue;
+        }
+        if(simScript[index].at <= simTime) {
+            before = &simScript[index];
+        } else {
+            after = &simScript[index];
+            break;
+        }
+    }
+
+    // no script for the axis: X sweeps from side to side, Y stays centred
+    if(!before && !after) {
+        if(type == EVENT_JS_Y) {
+            return (SIM_ADC_MAX + 1) / 2;
+        }
+        phase = simTime % (SIM_SWEEP_MS * SIM_NS_PER_MS);
+        phase = phase * 2 * SIM_ADC_MAX / (SIM_SWEEP_MS * SIM_NS_PER_MS);
+        return (int)(phase <= SIM_ADC_MAX ? phase : 2 * SIM_ADC_MAX - phase);
+    }
+
+    if(!after) {
+        return before->value;
+    }
+    if(!before) {
+        return after->value;
+    }
+
+    // ramp between the two points
+    return before->value + (int)((long long)(after->value - before->value)
+                                 * (long long)(simTime - before->at) / (long long)(after->at - before->at));
+}
+
+///////////////////////////////////////////////////////////////////////
+// simAnalog - Gets the reading of an analog input
+// Arguments: analogChannel - analog input
+// Return Value: ADC reading
+///////////////////////////////////////////////////////////////////////
+static int simAnalog(int analogChannel)
+{
+    if(analogChannel == SIM_JS_X_AIN) {
+        return simJoystick(EVENT_JS_X);
+    }
+    if(analogChannel == SIM_JS_Y_AIN) {
+        return simJoystick(EVENT_JS_Y);
+    }
+    return (SIM_ADC_MAX + 1) / 2;
+}
+
+///////////////////////////////////////////////////////////////////////
+// simNextButton - Finds the next scripted button press not yet run
+// Arguments: none
+// Return Value: index into simScript, or simScriptLength if none
+///////////////////////////////////////////////////////////////////////
+static int simNextButton(void)
+{
+    while(simButtonIndex < simScriptLength
+          && simScript[simButtonIndex].type != EVENT_S1 && simScript[simButtonIndex].type != EVENT_S2) {
+        simButtonIndex++;
+    }
+    return simButtonIndex;
+}
+
+///////////////////////////////////////////////////////////////////////
+// simNextInterrupt - Finds the interrupt that comes due first
+// Arguments: at - set to the time it comes due
+// Return Value: SOURCE_ of the interrupt, SOURCE_NONE if there is none
+///////////////////////////////////////////////////////////////////////
+static int simNextInterrupt(unsigned long long *at)
+{
+    int source = SOURCE_NONE;
+    int button = simNextButton();
+
+    *at = SIM_NEVER;
+    if(dmaHandler && dmaIrqPending && dmaDoneAt < *at) {
+        *at = dmaDoneAt;
+        source = SOURCE_DMA;
+    }
+    if(i2cHandler && i2cIrqPending && i2cDoneAt < *at) {
+        *at = i2cDoneAt;
+        source = SOURCE_I2C;
+    }
+    if(adcHandler && adcNext < *at) {
+        *at = adcNext;
+        source = SOURCE_ADC;
+    }
+    if(tickHandler && tickNext < *at) {
+        *at = tickNext;
+        source = SOURCE_TICK;
+    }
+    if(buttonHandler && button < simScriptLength && simScript[button].at < *at) {
+        *at = simScript[button].at;
+        source = SOURCE_BUTTON;
+    }
+    return source;
+}
+
+///////////////////////////////////////////////////////////////////////
+// simInterrupt - Runs the handler of an interrupt
+// Arguments: source - SOURCE_ of the interrupt
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void simInterrupt(int source)
+{
+    int results[ADC_MAX_CHANNELS];
+    int channel;
+    int button;
+
+    simInIsr = 1;
+
+    switch(source) {
+    case SOURCE_DMA:
+        dmaIrqPending = 0;
+        dmaHandler();
+        break;
+
+    case SOURCE_I2C:
+        i2cIrqPending = 0;
+        i2cHandler();
+        break;
+
+    case SOURCE_ADC:
+        // a burst that comes due while the last is not handled yet is lost
+        while(adcNext <= simTime) {
+            adcNext += adcPeriod;
+        }
+        for(channel = 0; channel < adcCount; channel++) {
+            results[channel] = simAnalog(adcChannels[channel]);
+        }
+        adcHandler(results);
+        break;
+
+    case SOURCE_TICK:
+        // the timer flag only holds one tick, later ones are lost until it is handled
+        while(tickNext <= simTime) {
+            tickNext += tickPeriod;
+        }
+        tickHandler();
+        break;
+
+    case SOURCE_BUTTON:
+        button = (simScript[simButtonIndex++].type == EVENT_S1) ? HAL_BUTTON_S1 : HAL_BUTTON_S2;
+        buttonHandler(button);
+        break;
+    }
+
+    simInIsr = 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// simSnapshot - Saves the screen into the snapshot directory, named by
+//               the virtual time in ms
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void simSnapshot(void)
+{
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/frame_%06llu.ppm", simPpmDir, simTime / SIM_NS_PER_MS);
+    if(st7735WritePpm(&simLcd, path)) {
+        fprintf(stderr, "sim: cannot write %s\n", path);
+        exit(1);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// simLoadReplay - Reads a log recorded with SIM_RECORD and starts
+//                 playing it
+// Arguments: path - file name of the log
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void simLoadReplay(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    long length;
+
+    if(!file || fseek(file, 0, SEEK_END) || (length = ftell(file)) < 0 || fseek(file, 0, SEEK_SET)) {
+        fprintf(stderr, "sim: cannot read %s\n", path);
+        exit(1);
+    }
+    simLog = malloc(length ? length : 1);
+    if(!simLog || fread(simLog, 1, length, file) != (size_t)length) {
+        fprintf(stderr, "sim: cannot read %s\n", path);
+        exit(1);
+    }
+    fclose(file);
+
+    if(length < 3 || simLog[0] != 'P' || simLog[1] != 'W' || simLog[2] != REPLAY_VERSION) {
+        fprintf(stderr, "sim: %s is not a replay log of this version\n", path);
+        exit(1);
+    }
+    replayPlayFrom(simLog, (int)length);
+    simReplaying = 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// simSaveRecording - Ends the recording and writes it to SIM_RECORD
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void simSaveRecording(void)
+{
+    FILE *file;
+
+    replayRecord(ticksSimulated, REPLAY_END, 0);
+    file = fopen(simRecordPath, "wb");
+    if(!file || fwrite(simLog, 1, replayLength, file) != (size_t)replayLength || fclose(file)) {
+        fprintf(stderr, "sim: cannot write %s\n", simRecordPath);
+        exit(1);
+    }
+    printf("sim: recorded %d bytes over %lu ticks to %s\n", replayLength, ticksSimulated, simRecordPath);
+}
+
+///////////////////////////////////////////////////////////////////////
+// simNow - Gets the virtual time
+// Arguments: none
+// Return Value: nanoseconds since the simulated board was reset
+///////////////////////////////////////////////////////////////////////
+unsigned long long simNow(void)
+{
+    return simTime;
+}
+
+///////////////////////////////////////////////////////////////////////
+// simAdvance - Lets virtual time pass, running the interrupts that come
+//              due (in order) if interrupts are enabled
+// Arguments: ns - nanoseconds to pass
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void simAdvance(unsigned long long ns)
+{
+    unsigned long long target = simTime + ns;
+    unsigned long long at;
+    int source;
+
+    // handlers may take time of their own, so the clock can end up past target
+    while(simIrqEnabled && !simInIsr && (source = simNextInterrupt(&at)) != SOURCE_NONE && at <= target) {
+        if(at > simTime) {
+            simTime = at;
+        }
+        simInterrupt(source);
+    }
+
+    if(simTime < target) {
+        simTime = target;
+    }
+
+    // snapshots show the screen part way through drawing, like a camera on the board would
+    if(simPpmEvery && simTime >= simPpmNext) {
+        simSnapshot();
+        simPpmNext += simPpmEvery;
+    }
+
+    if(simTime >= simEnd) {
+        simFinish();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// simPanel - Gets the simulated LCD controller
+// Arguments: none
+// Return Value: the controller fed by the SPI
+///////////////////////////////////////////////////////////////////////
+st7735 *simPanel(void)
+{
+    return &simLcd;
+}
+
+///////////////////////////////////////////////////////////////////////
+// simSpiTransfers - Gets the number of SPI transfers started, a single
+//                   byte write or a DMA run counting as one
+// Arguments: none
+// Return Value: transfers since the simulated board was reset
+///////////////////////////////////////////////////////////////////////
+unsigned long simSpiTransfers(void)
+{
+    return spiTransfers;
+}
+
+///////////////////////////////////////////////////////////////////////
+// simSetEnd - Changes the virtual time the run stops at
+// Arguments: ns - virtual time in ns, SIM_NEVER to run until simFinish
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void simSetEnd(unsigned long long ns)
+{
+    simEnd = ns;
+}
+
+#ifdef PROBE_ENABLE
+///////////////////////////////////////////////////////////////////////
+// simProbeReport - Prints the figures of one probe point, in host ns
+//                  (halCycles reads the host's clock in the simulator)
+// Arguments: group - probe group (the game level)
+//            probe - PROBE_ point
+//            stats - figures of the probe point
+//            mean - mean of the measurements
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void simProbeReport(int group, int probe, const probeStats *stats, unsigned long mean)
+{
+    printf("probe: level %d %-10s %8lu calls, min %7lu ns, mean %7lu ns, max %8lu ns\n",
+           group, probeName(probe), stats->count, stats->min, mean, stats->max);
+}
+#endif /* PROBE_ENABLE */
+
+///////////////////////////////////////////////////////////////////////
+// simFinish - Prints a summary of the run and exits
+// Arguments: none
+// Return Value: does not return
+///////////////////////////////////////////////////////////////////////
+void simFinish(void)
+{
+    const st7735Counters *counters = &simLcd.counters;
+    unsigned long long bytes = counters->commandBytes + counters->dataBytes;
+    unsigned long long busNs = bytes * 8 * 1000000000ULL / spiHz;
+
+    if(simPpm && st7735WritePpm(&simLcd, simPpm)) {
+        fprintf(stderr, "sim: cannot write %s\n", simPpm);
+        exit(1);
+    }
+
+    printf("sim: %llu.%03llu s, %lu frames, %lu ticks dropped\n",
+           simTime / (1000 * SIM_NS_PER_MS), simTime / SIM_NS_PER_MS % 1000, frameCount, ticksDropped);
+    printf("sim: spi %lu command bytes, %lu data bytes, %lu windows, %lu writes, %lu pixels\n",
+           counters->commandBytes, counters->dataBytes, counters->windows, counters->writes, counters->pixels);
+    printf("sim: spi bus %llu.%03llu ms at %llu Hz (%llu%% busy)\n",
+           busNs / SIM_NS_PER_MS, busNs / 1000 % 1000, spiHz, simTime ? busNs * 100 / simTime : 0);
+    if(simRecordPath) {
+        simSaveRecording();
+    }
+    if(simReplaying) {
+        printf("sim: frame hash %08lx over %lu frames, %lu ticks\n", simHash, simHashedFrames, ticksSimulated);
+    }
+    probeDump(simProbeReport);
+    exit(0);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halInit - Sets up the simulator from the environment
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halInit(void)
+{
+    const char *ms = getenv("SIM_MS");
+    const char *script = getenv("SIM_SCRIPT");
+    const char *hz = getenv("SIM_SPI_HZ");
+    const char *every = getenv("SIM_PPM_MS");
+    const char *replay = getenv("SIM_REPLAY");
+
+    simEnd = (ms ? strtoull(ms, 0, 10) : SIM_DEFAULT_MS) * SIM_NS_PER_MS;
+    if(script) {
+        simLoadScript(script);
+    }
+    spiHz = clockSpiHz(&clockConfigs[CLOCK_CONFIG]);
+    i2cHz = clockI2cHz(&clockConfigs[CLOCK_CONFIG]);
+    if(hz && strtoull(hz, 0, 10) > 0) {
+        spiHz = strtoull(hz, 0, 10);
+    }
+
+    simPpm = getenv("SIM_PPM");
+    simPpmDir = getenv("SIM_PPM_DIR");
+    if(simPpmDir && every) {
+        simPpmEvery = strtoull(every, 0, 10) * SIM_NS_PER_MS;
+        simPpmNext = simPpmEvery;
+    }
+
+    // a replay is played to its end, however long that takes
+    simRecordPath = getenv("SIM_RECORD");
+    if(replay) {
+        simLoadReplay(replay);
+        simRecordPath = 0;
+        simEnd = SIM_NEVER;
+    } else if(simRecordPath) {
+        simLog = malloc(SIM_RECORD_SIZE);
+        if(!simLog) {
+            fprintf(stderr, "sim: out of memory\n");
+            exit(1);
+        }
+        replayRecordTo(simLog, SIM_RECORD_SIZE);
+    }
+
+    st7735Reset(&simLcd);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halEnableInterrupts - Enables interrupts globally
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halEnableInterrupts(void)
+{
+    simIrqEnabled = 1;
+    simAdvance(SIM_CALL_NS);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halIrqSave - Disables interrupts for a critical section
+// Arguments: none
+// Return Value: interrupt state to be passed to halIrqRestore
+///////////////////////////////////////////////////////////////////////
+unsigned long halIrqSave(void)
+{
+    unsigned long state;
+
+    simAdvance(SIM_CALL_NS);
+    state = simIrqEnabled;
+    simIrqEnabled = 0;
+    return state;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halIrqRestore - Ends a critical section, interrupts are enabled again
+//                 only if they were enabled at the matching halIrqSave
+// Arguments: state - value returned by halIrqSave
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halIrqRestore(unsigned long state)
+{
+    simIrqEnabled = (int)state;
+
+    // interrupts that came due in the critical section run now
+    simAdvance(0);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halDelayMs - Busy waits for at least a number of milliseconds
+// Arguments: ms - milliseconds to wait
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halDelayMs(unsigned int ms)
+{
+    simAdvance(ms * SIM_NS_PER_MS);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halDelayUs - Busy waits for at least a number of microseconds
+// Arguments: us - microseconds to wait
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halDelayUs(unsigned int us)
+{
+    simAdvance(us * 1000ULL);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halCyclesInit - Nothing to start, halCycles reads the host's clock
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halCyclesInit(void)
+{
+}
+
+///////////////////////////////////////////////////////////////////////
+// halCycles - Reads the host's monotonic clock. This is real time, not
+//             virtual time, so it measures the game code on the host CPU.
+// Arguments: none
+// Return Value: nanoseconds, wrapping every 2^32
+///////////////////////////////////////////////////////////////////////
+unsigned long halCycles(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)((unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec) & 0xFFFFFFFFUL;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halTimerJitter - Reads the virtual clock, so a seed built from it is
+//                  the same every run of the same script
+// Arguments: none
+// Return Value: virtual nanoseconds, wrapping every 2^32
+///////////////////////////////////////////////////////////////////////
+unsigned long halTimerJitter(void)
+{
+    simAdvance(SIM_CALL_NS);
+    return (unsigned long)(simTime & 0xFFFFFFFFUL);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halSpiInit - Nothing to set up, the LCD model is reset by halInit
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiInit(void)
+{
+    simAdvance(SIM_CALL_NS);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halLcdReset - Holding the reset pin resets the LCD model
+// Arguments: active - true to hold the LCD in reset, false to release it
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halLcdReset(int active)
+{
+    simAdvance(SIM_CALL_NS);
+    if(active) {
+        st7735Reset(&simLcd);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// halSpiWrite - Sends one byte to the LCD model, waiting for the
+//               previous byte to be shifted out first
+// Arguments: byte - value to be sent
+//            isData - true if byte is data, false if byte is a command
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiWrite(unsigned char byte, int isData)
+{
+    simAdvance(SIM_CALL_NS);
+    if(spiFreeAt > simTime) {
+        simAdvance(spiFreeAt - simTime);
+    }
+
+    st7735Write(&simLcd, byte, isData);
+    spiTransfers++;
+    spiFreeAt = simTime + 8 * 1000000000ULL / spiHz;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halSpiWriteRun - Sends bytes to the LCD model back to back, returning
+//                  once the last one is in the transmit buffer
+// Arguments: data - bytes to be sent
+//            length - number of bytes
+//            isData - true if bytes are data, false if they are commands
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiWriteRun(const unsigned char *data, int length, int isData)
+{
+    unsigned long long byteNs = 8 * 1000000000ULL / spiHz;
+    int index;
+
+    simAdvance(SIM_CALL_NS);
+    if(spiFreeAt > simTime) {
+        simAdvance(spiFreeAt - simTime);
+    }
+    if(length <= 0) {
+        return;
+    }
+
+    for(index = 0; index < length; index++) {
+        st7735Write(&simLcd, data[index], isData);
+    }
+    spiTransfers++;
+
+    // the last byte goes into the buffer once the one before it starts shifting out
+    spiFreeAt = simTime + length * byteNs;
+    simAdvance((length - 1) * byteNs);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halSpiDmaStart - Sends the bytes to the LCD model straight away and
+//                  completes the DMA once they would have been shifted out
+// Arguments: data - bytes to be sent
+//            length - number of bytes (1 to HAL_DMA_MAX_LENGTH)
+//            isData - true if bytes are data, false if they are commands
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiDmaStart(const unsigned char *data, int length, int isData)
+{
+    int index;
+
+    simAdvance(SIM_CALL_NS);
+    if(spiFreeAt > simTime) {
+        simAdvance(spiFreeAt - simTime);
+    }
+
+    for(index = 0; index < length; index++) {
+        st7735Write(&simLcd, data[index], isData);
+    }
+
+    dmaDoneAt = simTime + length * 8 * 1000000000ULL / spiHz;
+    spiFreeAt = dmaDoneAt;
+    spiTransfers++;
+    dmaActive = 1;
+    dmaIrqPending = 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halSpiDmaDone - Checks (and clears) the DMA completion flag
+// Arguments: none
+// Return Value: true once when the DMA started last has finished
+///////////////////////////////////////////////////////////////////////
+int halSpiDmaDone(void)
+{
+    simAdvance(SIM_CALL_NS);
+    if(dmaActive && simTime >= dmaDoneAt) {
+        dmaActive = 0;
+        dmaIrqPending = 0;
+        return 1;
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halSpiDmaOnDone - Sets the function called from the DMA interrupt
+// Arguments: handler - function to call, or 0 for none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halSpiDmaOnDone(void (*handler)(void))
+{
+    dmaHandler = handler;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halAdcInit - Remembers the analog inputs of the sequence
+// Arguments: analogChannels - the analog inputs, channel n into MEM[n]
+//            count - number of channels (1 to 8)
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halAdcInit(const int *analogChannels, int count)
+{
+    simAdvance(SIM_CALL_NS);
+    memcpy(adcChannels, analogChannels, count * sizeof(int));
+    adcCount = count;
+    adcHandler = 0;
+    adcNext = SIM_NEVER;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halAdcConvert - Converts the sequence set by halAdcInit and waits
+// Arguments: results - filled with the result of every channel
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halAdcConvert(int *results)
+{
+    int channel;
+
+    simAdvance(SIM_CALL_NS + adcCount * SIM_ADC_NS);
+    for(channel = 0; channel < adcCount; channel++) {
+        results[channel] = simAnalog(adcChannels[channel]);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// halAdcStartTimer - Converts the sequence set by halAdcInit over and
+//                    over, once every period
+// Arguments: period - SMCLK cycles between bursts
+//            handler - called from the ADC interrupt with the results
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halAdcStartTimer(int period, void (*handler)(const int *results))
+{
+    simAdvance(SIM_CALL_NS);
+    adcPeriod = period * 1000000000ULL / HAL_SMCLK_HZ;
+    adcNext = simTime + adcPeriod;
+    adcHandler = handler;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halI2cInit - Nothing to set up, the sensors always answer
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halI2cInit(void)
+{
+    simAdvance(SIM_CALL_NS);
+}
+
+///////////////////////////////////////////////////////////////////////
+// halI2cRecover - Gives up any transaction on the bus
+// Arguments: none
+// Return Value: I2C_OK, the simulated bus never gets stuck
+///////////////////////////////////////////////////////////////////////
+int halI2cRecover(void)
+{
+    i2cOnBus = 0;
+    i2cIrqPending = 0;
+    simAdvance(SIM_RECOVERY_NS);
+    return I2C_OK;
+}
+
+///////////////////////////////////////////////////////////////////////
+// simFindRegister - Finds a register of a fake sensor
+// Arguments: slaveAddr - slave address of the sensor
+//            regAddr - register address, or -1 for any register
+// Return Value: the register, or 0 if the sensor/register does not exist
+///////////////////////////////////////////////////////////////////////
+static simRegister *simFindRegister(char slaveAddr, int regAddr)
+{
+    unsigned int index;
+
+    for(index = 0; index < sizeof(simRegisters) / sizeof(simRegisters[0]); index++) {
+        if(simRegisters[index].slaveAddr == slaveAddr
+           && (regAddr < 0 || simRegisters[index].regAddr == (char)regAddr)) {
+            return &simRegisters[index];
+        }
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halI2cStart - Puts a transaction on the bus, it completes after the
+//               time the bytes take at the i2c clock
+// Arguments: transaction - transaction to carry out
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halI2cStart(i2cTransaction *transaction)
+{
+    int bits;   // bits on the bus, 9 per byte with the acknowledge
+
+    simAdvance(SIM_CALL_NS);
+
+    if(simFindRegister(transaction->slaveAddr, -1)) {
+        bits = 9 * (2 + transaction->txLength);
+        if(transaction->rxLength > 0) {
+            bits += 9 * (1 + transaction->rxLength);
+        }
+        i2cStatus = I2C_OK;
+    } else {
+        // nobody acknowledges the address
+        bits = 9;
+        i2cStatus = I2C_ERR_NACK;
+    }
+
+    i2cOnBus = transaction;
+    i2cDoneAt = simTime + (bits + 2) * 1000000000ULL / i2cHz;
+    i2cIrqPending = 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halI2cService - Completes the transaction on the bus once its time
+//                 has passed. Must be called with interrupts disabled.
+// Arguments: none
+// Return Value: I2C_PENDING while the transaction is on the bus (or
+//               there is none), then once I2C_OK or its I2C_ERR_ code
+///////////////////////////////////////////////////////////////////////
+int halI2cService(void)
+{
+    i2cTransaction *transaction = i2cOnBus;
+    simRegister *reg;
+    int index;
+
+    simAdvance(SIM_CALL_NS);
+    if(!transaction || simTime < i2cDoneAt) {
+        return I2C_PENDING;
+    }
+    i2cOnBus = 0;
+    i2cIrqPending = 0;
+
+    if(i2cStatus == I2C_OK) {
+        reg = simFindRegister(transaction->slaveAddr, (unsigned char)transaction->regAddr);
+
+        // 16 bit registers, MSB first
+        if(reg && transaction->txLength >= 2) {
+            reg->value = (transaction->txData[0] << 8) | transaction->txData[1];
+        }
+        for(index = 0; index < transaction->rxLength; index++) {
+            if(!reg) {
+                transaction->rxData[index] = 0;
+            } else if(index & 1) {
+                transaction->rxData[index] = reg->value & 0xFF;
+            } else {
+                transaction->rxData[index] = reg->value >> 8;
+            }
+        }
+    }
+
+    return i2cStatus;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halI2cOnEvent - Sets the function called from the UCB1 interrupt
+// Arguments: handler - function to call, or 0 for none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halI2cOnEvent(void (*handler)(void))
+{
+    i2cHandler = handler;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halButtonsInit - Scripted presses call handler from now on
+// Arguments: handler - called with HAL_BUTTON_S1 or HAL_BUTTON_S2
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halButtonsInit(void (*handler)(int button))
+{
+    simAdvance(SIM_CALL_NS);
+    buttonHandler = handler;
+
+    // presses scripted before now are missed, like on the board
+    while(simNextButton() < simScriptLength && simScript[simButtonIndex].at < simTime) {
+        simButtonIndex++;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// halButtonDown - Reads a button, pressed for SIM_BUTTON_HOLD_MS after
+//                 each scripted press
+// Arguments: button - HAL_BUTTON_S1 or HAL_BUTTON_S2
+// Return Value: true if the button is pressed
+///////////////////////////////////////////////////////////////////////
+int halButtonDown(int button)
+{
+    int type = (button == HAL_BUTTON_S1) ? EVENT_S1 : EVENT_S2;
+    int index;
+
+    simAdvance(SIM_CALL_NS);
+    for(index = 0; index < simScriptLength && simScript[index].at <= simTime; index++) {
+        if(simScript[index].type == type && simTime < simScript[index].at + SIM_BUTTON_HOLD_MS * SIM_NS_PER_MS) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halTickInit - Starts the tick interrupting once every period
+// Arguments: period - timer counts (HAL_TICK_HZ) per tick
+//            handler - called from the tick interrupt
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halTickInit(int period, void (*handler)(void))
+{
+    simAdvance(SIM_CALL_NS);
+    tickHandler = handler;
+    tickPeriod = period * 1000000000ULL / HAL_TICK_HZ;
+    tickNext = simTime + tickPeriod;
+}
+
+///////////////////////////////////////////////////////////////////////
+// halFrameDone - Adds the screen to the frame hash of a replay, and
+//                ends the run once the replay is over
+// Arguments: none
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void halFrameDone(void)
+{
+    unsigned short pixel;
+    int x, y;
+
+    if(!simReplaying) {
+        return;
+    }
+
+    // FNV-1a over the screen as it is seen, so any renderer drawing the same frames hashes the same
+    for(y = 0; y < ST7735_SCREEN_SIZE; y++) {
+        for(x = 0; x < ST7735_SCREEN_SIZE; x++) {
+            pixel = st7735Screen(&simLcd, x, y);
+            simHash = ((simHash ^ (pixel & 0xFF)) * SIM_HASH_PRIME) & 0xFFFFFFFFUL;
+            simHash = ((simHash ^ (pixel >> 8)) * SIM_HASH_PRIME) & 0xFFFFFFFFUL;
+        }
+    }
+    simHashedFrames++;
+
+    if(replayMode != REPLAY_MODE_PLAY) {
+        simFinish();
+    }
+}
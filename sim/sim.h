@@ -0,0 +1,81 @@
+// Filename: sim.h
+// Description: Linux simulator of the LaunchPad and BoosterPack. halsim.c implements hal.h
+//              on a virtual clock, with an in-memory ST7735, scripted joystick and buttons
+//              and fake i2c sensors, so the game runs unchanged on a workstation.
+//
+//              The simulator is set up from the environment:
+//                SIM_MS      - virtual milliseconds to run for (default 10000)
+//                SIM_SPI_HZ  - SPI clock used for the bus time (default from clocks.h)
+//                SIM_PPM     - file the screen is saved to (binary PPM) when the run ends
+//                SIM_PPM_DIR - directory screen snapshots are saved to, frame_<ms>.ppm ...
+//                SIM_PPM_MS  - ... every this many virtual milliseconds
+//                SIM_RECORD  - file the seed and inputs are recorded to (replay.h)
+//                SIM_REPLAY  - recorded file to play back instead of the inputs below, the
+//                              run lasts until its end and prints a hash of the frames
+//                SIM_SCRIPT  - input script, one event per line:
+//                                <ms> js <value>   joystick X reads value (0 to 16383) at ms,
+//                                                  ramping linearly from the previous js line
+//                                <ms> jy <value>   same for joystick Y
+//                                <ms> s1           S1 pressed at ms (held SIM_BUTTON_HOLD_MS)
+//                                <ms> s2           S2 pressed at ms
+//                                <ms> end          stop the simulation at ms
+//                              '#' starts a comment. Without a script the joystick sweeps
+//                              from side to side.
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include "st7735.h"
+
+#define SIM_NS_PER_MS       1000000ULL
+#define SIM_BUTTON_HOLD_MS  50          // how long a scripted button press is held
+#define SIM_NEVER           (~0ULL)     // virtual time that never comes
+
+///////////////////////////////////////////////////////////////////////
+// simNow - Gets the virtual time
+// Arguments: none
+// Return Value: nanoseconds since the simulated board was reset
+///////////////////////////////////////////////////////////////////////
+unsigned long long simNow(void);
+
+///////////////////////////////////////////////////////////////////////
+// simAdvance - Lets virtual time pass, running the interrupts that come
+//              due (in order) if interrupts are enabled
+// Arguments: ns - nanoseconds to pass
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void simAdvance(unsigned long long ns);
+
+///////////////////////////////////////////////////////////////////////
+// simPanel - Gets the simulated LCD controller
+// Arguments: none
+// Return Value: the controller fed by the SPI
+///////////////////////////////////////////////////////////////////////
+st7735 *simPanel(void);
+
+///////////////////////////////////////////////////////////////////////
+// simSpiTransfers - Gets the number of SPI transfers started, a single
+//                   byte write or a DMA run counting as one
+// Arguments: none
+// Return Value: transfers since the simulated board was reset
+///////////////////////////////////////////////////////////////////////
+unsigned long simSpiTransfers(void);
+
+///////////////////////////////////////////////////////////////////////
+// simSetEnd - Changes the virtual time the run stops at
+// Arguments: ns - virtual time in ns, SIM_NEVER to run until simFinish
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void simSetEnd(unsigned long long ns);
+
+///////////////////////////////////////////////////////////////////////
+// simFinish - Prints a summary of the run and exits
+// Arguments: none
+// Return Value: does not return
+///////////////////////////////////////////////////////////////////////
+void simFinish(void);
+
+#endif /* SIM_H_ */
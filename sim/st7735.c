@@ -0,0 +1,303 @@
+// Filename: st7735.c
+// Description: Model of the ST7735 LCD controller for the Linux simulator. Decodes the
+//              command/data byte stream sent over SPI into the controller's frame memory,
+//              counts what it costs, and shows the 128x128 part the player sees
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#include <stdio.h>
+#include <string.h>
+#include "st7735.h"
+
+// Commands the model acts on (the rest are accepted and ignored)
+#define CM_SWRESET         0x01
+#define CM_SLPIN           0x10
+#define CM_SLPOUT          0x11
+#define CM_PTLON           0x12
+#define CM_NORON           0x13
+#define CM_DISPOFF         0x28
+#define CM_DISPON          0x29
+#define CM_CASET           0x2A
+#define CM_RASET           0x2B
+#define CM_RAMWR           0x2C
+#define CM_PTLAR           0x30
+#define CM_VSCRDEF         0x33
+#define CM_MADCTL          0x36
+#define CM_VSCSAD          0x37
+#define CM_COLMOD          0x3A
+#define CM_MADCTL_MY       0x80
+#define CM_MADCTL_MX       0x40
+#define CM_MADCTL_MV       0x20
+#define CM_MADCTL_BGR      0x08
+
+// Interface pixel formats (COLMOD)
+#define COLMOD_16BIT       0x05     // RGB565, 2 bytes per pixel
+#define COLMOD_18BIT       0x06     // 6 bits per colour in the top of 3 bytes
+
+#define NO_COMMAND         -1
+
+///////////////////////////////////////////////////////////////////////
+// st7735Reset - Puts the controller in its hardware reset state, the
+//               counters keep counting
+// Arguments: panel - controller to reset
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void st7735Reset(st7735 *panel)
+{
+    st7735Counters counters = panel->counters;
+
+    memset(panel, 0, sizeof(*panel));
+    panel->counters = counters;
+    panel->command = NO_COMMAND;
+    panel->columnEnd = ST7735_COLUMNS - 1;
+    panel->rowEnd = ST7735_ROWS - 1;
+    panel->colmod = COLMOD_18BIT;
+    panel->sleeping = 1;
+    panel->partialEnd = ST7735_ROWS - 1;
+    panel->scrollRows = ST7735_ROWS;
+}
+
+///////////////////////////////////////////////////////////////////////
+// st7735ClearCounters - Starts counting bytes from zero
+// Arguments: panel - controller to clear
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void st7735ClearCounters(st7735 *panel)
+{
+    memset(&panel->counters, 0, sizeof(panel->counters));
+}
+
+///////////////////////////////////////////////////////////////////////
+// st7735Pixel - Writes one pixel of a RAMWR and moves to the next
+//               location of the address window
+// Arguments: panel - controller receiving the pixel
+//            colour - RGB565 colour of the pixel
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+static void st7735Pixel(st7735 *panel, unsigned short colour)
+{
+    int column = panel->column;
+    int row = panel->row;
+    int swap;
+
+    // MADCTL: exchange, then mirror, the address counters on their way to frame memory
+    if(panel->madctl & CM_MADCTL_MV) {
+        swap = column;
+        column = row;
+        row = swap;
+    }
+    if(panel->madctl & CM_MADCTL_MX) {
+        column = ST7735_COLUMNS - 1 - column;
+    }
+    if(panel->madctl & CM_MADCTL_MY) {
+        row = ST7735_ROWS - 1 - row;
+    }
+
+    if(row >= 0 && row < ST7735_ROWS && column >= 0 && column < ST7735_COLUMNS) {
+        panel->ram[row][column] = colour;
+    }
+    panel->counters.pixels++;
+
+    // column runs first, then wraps to the next row of the window
+    if(++panel->column > panel->columnEnd) {
+        panel->column = panel->columnStart;
+        if(++panel->row > panel->rowEnd) {
+            panel->row = panel->rowStart;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// st7735Write - Feeds one byte sent over SPI to the controller
+// Arguments: panel - controller receiving the byte
+//            byte - value sent
+//            isData - state of the data/command pin
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void st7735Write(st7735 *panel, unsigned char byte, int isData)
+{
+    if(!isData) {
+        panel->counters.commandBytes++;
+        panel->command = byte;
+        panel->paramCount = 0;
+        panel->pixelBytes = 0;
+
+        switch(byte) {
+        case CM_SWRESET:
+            st7735Reset(panel);
+            break;
+        case CM_SLPIN:
+            panel->sleeping = 1;
+            break;
+        case CM_SLPOUT:
+            panel->sleeping = 0;
+            break;
+        case CM_DISPOFF:
+            panel->displayOn = 0;
+            break;
+        case CM_DISPON:
+            panel->displayOn = 1;
+            break;
+        case CM_PTLON:
+            panel->partial = 1;
+            panel->scrolling = 0;
+            break;
+        case CM_NORON:
+            panel->partial = 0;
+            panel->scrolling = 0;
+            break;
+        case CM_CASET:
+        case CM_RASET:
+            panel->counters.windows++;
+            break;
+        case CM_RAMWR:
+            // writing starts at the start of the address window
+            panel->counters.writes++;
+            panel->column = panel->columnStart;
+            panel->row = panel->rowStart;
+            break;
+        }
+        return;
+    }
+
+    panel->counters.dataBytes++;
+
+    if(panel->command == CM_RAMWR) {
+        panel->pixel[panel->pixelBytes++] = byte;
+
+        if(panel->colmod == COLMOD_16BIT && panel->pixelBytes == 2) {
+            st7735Pixel(panel, (unsigned short)((panel->pixel[0] << 8) | panel->pixel[1]));
+            panel->pixelBytes = 0;
+        } else if(panel->pixelBytes == 3) {
+            // 18 bit: keep the top 5/6/5 bits of each colour byte
+            st7735Pixel(panel, (unsigned short)(((panel->pixel[0] & 0xF8) << 8)
+                                                | ((panel->pixel[1] & 0xFC) << 3)
+                                                | (panel->pixel[2] >> 3)));
+            panel->pixelBytes = 0;
+        }
+        return;
+    }
+
+    if(panel->paramCount < (int)sizeof(panel->params)) {
+        panel->params[panel->paramCount] = byte;
+    }
+    panel->paramCount++;
+
+    switch(panel->command) {
+    case CM_CASET:
+        if(panel->paramCount == 4) {
+            panel->columnStart = (panel->params[0] << 8) | panel->params[1];
+            panel->columnEnd = (panel->params[2] << 8) | panel->params[3];
+        }
+        break;
+    case CM_RASET:
+        if(panel->paramCount == 4) {
+            panel->rowStart = (panel->params[0] << 8) | panel->params[1];
+            panel->rowEnd = (panel->params[2] << 8) | panel->params[3];
+        }
+        break;
+    case CM_PTLAR:
+        if(panel->paramCount == 4) {
+            panel->partialStart = (panel->params[0] << 8) | panel->params[1];
+            panel->partialEnd = (panel->params[2] << 8) | panel->params[3];
+        }
+        break;
+    case CM_VSCRDEF:
+        // the fixed rows above the area (last two parameters) are what is left
+        if(panel->paramCount == 6) {
+            panel->scrollTop = (panel->params[0] << 8) | panel->params[1];
+            panel->scrollRows = (panel->params[2] << 8) | panel->params[3];
+        }
+        break;
+    case CM_VSCSAD:
+        if(panel->paramCount == 2) {
+            panel->scrollStart = (panel->params[0] << 8) | panel->params[1];
+            panel->scrolling = 1;
+        }
+        break;
+    case CM_MADCTL:
+        panel->madctl = byte;
+        break;
+    case CM_COLMOD:
+        panel->colmod = byte & 0x07;
+        break;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+// st7735Screen - Gets the colour the player sees at a point of the
+//                screen (black while the display is off or asleep, and
+//                outside the partial area in partial mode)
+// Arguments: panel - controller
+//            x, y - screen location, (0,0) is the bottom left corner
+// Return Value: RGB565 colour
+///////////////////////////////////////////////////////////////////////
+unsigned short st7735Screen(const st7735 *panel, int x, int y)
+{
+    unsigned short colour;
+    int row = ST7735_SCREEN_ROW + y;    // line of the panel, then the row of memory it shows
+
+    if(!panel->displayOn || panel->sleeping) {
+        return 0;
+    }
+
+    // partial area may wrap past the last row
+    if(panel->partial && (panel->partialStart <= panel->partialEnd
+                          ? row < panel->partialStart || row > panel->partialEnd
+                          : row < panel->partialStart && row > panel->partialEnd)) {
+        return 0;
+    }
+
+    // lines of the scroll area show memory from the start row on, wrapping within the area
+    if(panel->scrolling && panel->scrollRows > 0
+       && row >= panel->scrollTop && row < panel->scrollTop + panel->scrollRows) {
+        row = panel->scrollTop + ((row - panel->scrollTop) + (panel->scrollStart - panel->scrollTop) % panel->scrollRows
+                                  + panel->scrollRows) % panel->scrollRows;
+    }
+    if(row < 0 || row >= ST7735_ROWS) {
+        return 0;
+    }
+
+    colour = panel->ram[row][ST7735_SCREEN_COLUMN + ST7735_SCREEN_SIZE - 1 - x];
+
+    // the panel's colour filters are in BGR order, without the MADCTL BGR bit red and blue swap
+    if(!(panel->madctl & CM_MADCTL_BGR)) {
+        colour = (colour & 0x07E0) | (colour >> 11) | ((colour & 0x001F) << 11);
+    }
+    return colour;
+}
+
+///////////////////////////////////////////////////////////////////////
+// st7735WritePpm - Saves what the player sees as a binary PPM image
+// Arguments: panel - controller
+//            path - file name of the image
+// Return Value: 0 if saved, -1 if the file could not be written
+///////////////////////////////////////////////////////////////////////
+int st7735WritePpm(const st7735 *panel, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    unsigned short colour;
+    unsigned char rgb[3];
+    int x, y;
+
+    if(!file) {
+        return -1;
+    }
+
+    // top row of the image is the top of the screen
+    fprintf(file, "P6\n%d %d\n255\n", ST7735_SCREEN_SIZE, ST7735_SCREEN_SIZE);
+    for(y = ST7735_SCREEN_SIZE - 1; y >= 0; y--) {
+        for(x = 0; x < ST7735_SCREEN_SIZE; x++) {
+            colour = st7735Screen(panel, x, y);
+
+            // widen 5/6/5 bits to 8, repeating the top bits into the bottom
+            rgb[0] = ((colour >> 11) << 3) | (colour >> 13);
+            rgb[1] = (((colour >> 5) & 0x3F) << 2) | ((colour >> 9) & 0x03);
+            rgb[2] = ((colour & 0x1F) << 3) | ((colour >> 2) & 0x07);
+            fwrite(rgb, 1, sizeof(rgb), file);
+        }
+    }
+
+    return fclose(file) ? -1 : 0;
+}
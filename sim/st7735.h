@@ -0,0 +1,97 @@
+// Filename: st7735.h
+// Description: Model of the ST7735 LCD controller for the Linux simulator. Decodes the
+//              command/data byte stream sent over SPI into the controller's frame memory,
+//              counts what it costs, and shows the 128x128 part the player sees
+// Author(s): Jimmy Bates
+// Set: N/A
+// Date: Dec 2, 2020
+
+#ifndef ST7735_H_
+#define ST7735_H_
+
+// Frame memory of the controller
+#define ST7735_COLUMNS      132
+#define ST7735_ROWS         162
+
+// Part of the frame memory shown by the 128x128 panel of the BoosterPack. The panel is
+// mounted turned half way round, so screen x runs down the columns and screen y (0 at
+// the bottom) up the rows.
+#define ST7735_SCREEN_SIZE  128
+#define ST7735_SCREEN_COLUMN 2      // column of the right edge of the screen
+#define ST7735_SCREEN_ROW   1       // row of the bottom edge of the screen
+
+// Bytes seen by the controller, cleared by st7735ClearCounters
+typedef struct {
+    unsigned long commandBytes;     // bytes sent with DC low
+    unsigned long dataBytes;        // bytes sent with DC high (parameters and pixels)
+    unsigned long windows;          // CASET and RASET commands
+    unsigned long writes;           // RAMWR commands
+    unsigned long pixels;           // pixels written to frame memory
+} st7735Counters;
+
+// State of the controller
+typedef struct {
+    unsigned short ram[ST7735_ROWS][ST7735_COLUMNS];   // frame memory, RGB565 as sent
+    int command;                // command receiving parameters, -1 for none
+    int paramCount;             // parameters received for the command
+    unsigned char params[6];    // first parameters of the command
+    int columnStart, columnEnd; // address window set by CASET
+    int rowStart, rowEnd;       // address window set by RASET
+    int column, row;            // next location written by RAMWR
+    int pixelBytes;             // bytes of the pixel being received
+    unsigned char pixel[3];
+    int madctl;                 // memory access control set by MADCTL
+    int colmod;                 // interface pixel format set by COLMOD
+    int sleeping;               // true until SLPOUT
+    int displayOn;              // true after DISPON
+    int partial;                // true after PTLON, until NORON
+    int partialStart, partialEnd; // rows shown in partial mode, set by PTLAR
+    int scrolling;              // true after VSCSAD, until NORON or PTLON
+    int scrollTop, scrollRows;  // vertical scroll area set by VSCRDEF (fixed rows below it)
+    int scrollStart;            // row shown at the start of the scroll area, set by VSCSAD
+    st7735Counters counters;
+} st7735;
+
+///////////////////////////////////////////////////////////////////////
+// st7735Reset - Puts the controller in its hardware reset state, the
+//               counters keep counting
+// Arguments: panel - controller to reset
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void st7735Reset(st7735 *panel);
+
+///////////////////////////////////////////////////////////////////////
+// st7735Write - Feeds one byte sent over SPI to the controller
+// Arguments: panel - controller receiving the byte
+//            byte - value sent
+//            isData - state of the data/command pin
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void st7735Write(st7735 *panel, unsigned char byte, int isData);
+
+///////////////////////////////////////////////////////////////////////
+// st7735ClearCounters - Starts counting bytes from zero
+// Arguments: panel - controller to clear
+// Return Value: none
+///////////////////////////////////////////////////////////////////////
+void st7735ClearCounters(st7735 *panel);
+
+///////////////////////////////////////////////////////////////////////
+// st7735Screen - Gets the colour the player sees at a point of the
+//                screen (black while the display is off or asleep, and
+//                outside the partial area in partial mode)
+// Arguments: panel - controller
+//            x, y - screen location, (0,0) is the bottom left corner
+// Return Value: RGB565 colour
+///////////////////////////////////////////////////////////////////////
+unsigned short st7735Screen(const st7735 *panel, int x, int y);
+
+///////////////////////////////////////////////////////////////////////
+// st7735WritePpm - Saves what the player sees as a binary PPM image
+// Arguments: panel - controller
+//            path - file name of the image
+// Return Value: 0 if saved, -1 if the file could not be written
+///////////////////////////////////////////////////////////////////////
+int st7735WritePpm(const st7735 *panel, const char *path);
+
+#endif /* ST7735_H_ */